@@ -0,0 +1,121 @@
+/*
+ * Cryptographic API.
+ * CRC32C folding using NEON polynomial multiplies
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * Only NEON code lives in this file; it must be called between
+ * kernel_neon_begin() and kernel_neon_end() from crc32c-neon-glue.c.
+ *
+ * The input is treated as a polynomial over GF(2) in the bit reflected
+ * order used by CRC32C: the lowest bit of each byte is the highest power.
+ * Four 128 bit accumulators walk the buffer 64 bytes at a time. Each one
+ * is multiplied forward by x^512 modulo the CRC polynomial and xored with
+ * the next 16 bytes of its lane, which leaves the CRC of the data intact.
+ * At the end the lanes are folded into one another 128 bits at a time.
+ *
+ * ARMv7 has no 64 bit carryless multiply, so the 64x32 bit products the
+ * folding needs are assembled from four vmull.p8, one for each byte of the
+ * 32 bit folding constant.
+ */
+
+#include <arm_neon.h>
+
+#ifndef __ARM_NEON__
+#error You should compile this file with '-mfloat-abi=softfp -mfpu=neon'
+#endif
+
+/* x^(n+63) and x^(n-1) mod P, bit reflected, for folding by n bits */
+#define FOLD512_LO	0x1c19243b
+#define FOLD512_HI	0x75bba45b
+#define FOLD128_LO	0x3743f7bd
+#define FOLD128_HI	0x3171d430
+
+struct fold_key {
+	poly8x8_t	b[4];
+};
+
+static inline void fold_key_init(struct fold_key *k, uint32_t c)
+{
+	k->b[0] = vdup_n_p8(c);
+	k->b[1] = vdup_n_p8(c >> 8);
+	k->b[2] = vdup_n_p8(c >> 16);
+	k->b[3] = vdup_n_p8(c >> 24);
+}
+
+/*
+ * 64x8 bit carryless multiply of @a by byte @b, returned as a 72 bit value
+ * in the low bytes of a 128 bit vector.
+ */
+static inline uint8x16_t clmul_64x8(uint8x8_t a, poly8x8_t b)
+{
+	poly16x8_t prod = vmull_p8(vreinterpret_p8_u8(a), b);
+	uint16x8_t p = vreinterpretq_u16_p16(prod);
+	uint8x16_t lo = vcombine_u8(vmovn_u16(p), vdup_n_u8(0));
+	uint8x16_t hi = vcombine_u8(vshrn_n_u16(p, 8), vdup_n_u8(0));
+
+	return veorq_u8(lo, vextq_u8(vdupq_n_u8(0), hi, 15));
+}
+
+/*
+ * Multiply 64 bits of accumulator by a reflected 32 bit constant. The
+ * result is shifted up by 32 bits so that it lines up with the 128 bit
+ * lane it is folded into.
+ */
+static inline uint8x16_t clmul_64x32(uint8x8_t a, const struct fold_key *k)
+{
+	uint8x16_t z = vdupq_n_u8(0);
+	uint8x16_t r;
+
+	r = vextq_u8(z, clmul_64x8(a, k->b[0]), 12);
+	r = veorq_u8(r, vextq_u8(z, clmul_64x8(a, k->b[1]), 11));
+	r = veorq_u8(r, vextq_u8(z, clmul_64x8(a, k->b[2]), 10));
+	r = veorq_u8(r, vextq_u8(z, clmul_64x8(a, k->b[3]), 9));
+	return r;
+}
+
+static inline uint8x16_t fold(uint8x16_t acc, uint8x16_t data,
+			      const struct fold_key *lo,
+			      const struct fold_key *hi)
+{
+	data = veorq_u8(data, clmul_64x32(vget_low_u8(acc), lo));
+	return veorq_u8(data, clmul_64x32(vget_high_u8(acc), hi));
+}
+
+/*
+ * Fold @len bytes at @p, a non-zero multiple of 64, into the 16 bytes at
+ * @out. The CRC32C of @out with a zero seed equals the CRC32C of @p with
+ * seed @crc.
+ */
+void crc32c_neon_fold(uint32_t crc, const uint8_t *p, unsigned int len,
+		      uint8_t *out)
+{
+	struct fold_key k512_lo, k512_hi, k128_lo, k128_hi;
+	uint8x16_t a0, a1, a2, a3;
+	uint32_t seed[4] = { crc, 0, 0, 0 };
+
+	fold_key_init(&k512_lo, FOLD512_LO);
+	fold_key_init(&k512_hi, FOLD512_HI);
+	fold_key_init(&k128_lo, FOLD128_LO);
+	fold_key_init(&k128_hi, FOLD128_HI);
+
+	a0 = veorq_u8(vld1q_u8(p), vreinterpretq_u8_u32(vld1q_u32(seed)));
+	a1 = vld1q_u8(p + 16);
+	a2 = vld1q_u8(p + 32);
+	a3 = vld1q_u8(p + 48);
+
+	for (p += 64, len -= 64; len; p += 64, len -= 64) {
+		a0 = fold(a0, vld1q_u8(p), &k512_lo, &k512_hi);
+		a1 = fold(a1, vld1q_u8(p + 16), &k512_lo, &k512_hi);
+		a2 = fold(a2, vld1q_u8(p + 32), &k512_lo, &k512_hi);
+		a3 = fold(a3, vld1q_u8(p + 48), &k512_lo, &k512_hi);
+	}
+
+	a1 = fold(a0, a1, &k128_lo, &k128_hi);
+	a2 = fold(a1, a2, &k128_lo, &k128_hi);
+	a3 = fold(a2, a3, &k128_lo, &k128_hi);
+
+	vst1q_u8(out, a3);
+}
@@ -377,10 +377,16 @@ static int krait_l2_add_event(struct perf_event *event, int flags)
 		}
 	}
 
+	/*
+	 * The L2 counters are shared by all CPUs, so running out of them is
+	 * expected when several CPUs schedule L2 events at once. The perf
+	 * core leaves the event inactive and rotates it in later, don't
+	 * complain about it.
+	 */
 	if (hwc->idx < 0) {
 		err = -ENOSPC;
-		pr_err("%s: No space for event: %llx!!\n", __func__,
-		       event->attr.config);
+		pr_debug("%s: No space for event: %llx\n", __func__,
+			 event->attr.config);
 		goto out;
 	}
 
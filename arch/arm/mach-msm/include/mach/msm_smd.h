@@ -19,6 +19,7 @@
 #define __ASM_ARCH_MSM_SMD_H
 
 #include <linux/io.h>
+#include <linux/uio.h>
 #include <mach/msm_smsm.h>
 
 typedef struct smd_channel smd_channel_t;
@@ -309,6 +310,46 @@ const char *smd_pid_to_subsystem(uint32_t pid);
  */
 int smd_is_pkt_avail(smd_channel_t *ch);
 
+/*
+ * Zero-copy access to the channel fifos.
+ *
+ * smd_write_reserve() returns a pointer to, and the length of, the next
+ * contiguous free region of the transmit fifo.  The caller fills in up to
+ * that many bytes and publishes them with smd_write_commit().  Committed
+ * data is not signalled to the remote processor until smd_write_flush() is
+ * called, so several commits can share a single interrupt.  On packet
+ * channels, reserve/commit may only be used between smd_write_start() and
+ * smd_write_end(); smd_write_end() flushes the packet.
+ *
+ * smd_read_peek() returns a pointer to, and the length of, the next
+ * contiguous readable region of the receive fifo, limited to the current
+ * packet on packet channels.  smd_read_consume() releases the bytes back to
+ * the remote processor.
+ *
+ * Returns:
+ *      number of bytes available / committed / consumed
+ *      -ENODEV - invalid smd channel
+ *      -EINVAL - length exceeds the reserved or peeked region
+ *      -ENOEXEC - packet channel without a transaction in progress
+ */
+int smd_write_reserve(smd_channel_t *ch, void **data);
+int smd_write_commit(smd_channel_t *ch, int len);
+void smd_write_flush(smd_channel_t *ch);
+int smd_read_peek(smd_channel_t *ch, void **data);
+int smd_read_consume(smd_channel_t *ch, int len);
+
+/* Gathers the buffers described by @vec into the channel with a single
+ * remote interrupt.  On packet channels all buffers form a single packet
+ * and the write is all-or-nothing; stream channels may do a partial write.
+ *
+ * Returns:
+ *      number of bytes written
+ *      -ENODEV - invalid smd channel
+ *      -EBUSY - packet transaction in progress
+ *      -ENOMEM - not enough room in the fifo for the packet
+ */
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int nvec);
+
 /**
  * smd_module_init_notifier_register() - Register a smd module
  *					 init notifier block
@@ -456,6 +497,36 @@ static inline int smd_is_pkt_avail(smd_channel_t *ch)
 	return -ENODEV;
 }
 
+static inline int smd_write_reserve(smd_channel_t *ch, void **data)
+{
+	return -ENODEV;
+}
+
+static inline int smd_write_commit(smd_channel_t *ch, int len)
+{
+	return -ENODEV;
+}
+
+static inline void smd_write_flush(smd_channel_t *ch)
+{
+}
+
+static inline int smd_read_peek(smd_channel_t *ch, void **data)
+{
+	return -ENODEV;
+}
+
+static inline int smd_read_consume(smd_channel_t *ch, int len)
+{
+	return -ENODEV;
+}
+
+static inline int
+smd_writev(smd_channel_t *ch, const struct kvec *vec, int nvec)
+{
+	return -ENODEV;
+}
+
 static inline int smd_module_init_notifier_register(struct notifier_block *nb)
 {
 	return -ENODEV;
@@ -0,0 +1,441 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Self test and benchmark for iommu_map_range()/iommu_unmap_range().
+ *
+ * The test allocates a domain and never attaches it, so the page tables
+ * live in memory only and the TLB flushes have no context to act on: a
+ * mock IOMMU.  The physical addresses mapped are made up and never
+ * touched.  After each operation the page tables are walked in software
+ * to check every 4K page translates to the expected address, that the
+ * largest entry that fits was used and that supersections and 64K pages
+ * are always complete.
+ *
+ * The benchmark then maps and unmaps a buffer laid out as scattered 4K
+ * pages, 64K chunks, 1M chunks and one contiguous block, and the 4K
+ * layout once more a page at a time with iommu_map(), the way buffers
+ * were mapped before map_range.  Results are reported in the kernel log
+ * and the module does not stay loaded.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/iommu.h>
+#include <linux/scatterlist.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/vmalloc.h>
+
+#include <asm/sizes.h>
+
+#include <mach/iommu_hw-8xxx.h>
+
+static unsigned int bench_mb = 64;
+module_param(bench_mb, uint, S_IRUGO);
+MODULE_PARM_DESC(bench_mb, "Size of the benchmark buffer in MB (max 256)");
+
+static unsigned int iterations = 20;
+module_param(iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(iterations, "Map/unmap rounds per benchmark layout");
+
+#define IT_PROT		(IOMMU_READ | IOMMU_WRITE)
+#define IT_BENCH_VA	0x80000000
+
+static int failures;
+
+#define it_check(cond, fmt, ...)					\
+do {									\
+	if (!(cond)) {							\
+		pr_err("iommu_test: FAIL %s:%d: " fmt "\n", __func__,	\
+		       __LINE__, ##__VA_ARGS__);			\
+		failures++;						\
+	}								\
+} while (0)
+
+enum { IT_SUPER, IT_SECT, IT_LARGE, IT_SMALL, IT_NR_TYPES };
+
+struct it_chunk {
+	unsigned int pa;
+	unsigned int len;
+};
+
+static unsigned long *fl_table;
+
+static int it_map(struct iommu_domain *domain, unsigned int va,
+		  const struct it_chunk *chunks, int n)
+{
+	struct sg_table table;
+	struct scatterlist *sg;
+	unsigned int len = 0;
+	int i, ret;
+
+	ret = sg_alloc_table(&table, n, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sg(table.sgl, sg, n, i) {
+		sg_dma_address(sg) = chunks[i].pa;
+		sg->length = chunks[i].len;
+		len += chunks[i].len;
+	}
+
+	ret = iommu_map_range(domain, va, table.sgl, len, IT_PROT);
+	sg_free_table(&table);
+	return ret;
+}
+
+/*
+ * Translate @va the way the hardware would; 0 if unmapped.  @type is set
+ * to the kind of entry that maps it.
+ */
+static unsigned int it_walk(unsigned int va, int *type)
+{
+	unsigned long *fl_pte = fl_table + (va >> 20);
+	unsigned long *sl_table, *sl_pte;
+	unsigned long *first;
+	int i;
+
+	if (!*fl_pte)
+		return 0;
+
+	if ((*fl_pte & 0x03) == FL_TYPE_SECT) {
+		if (!(*fl_pte & FL_SUPERSECTION)) {
+			*type = IT_SECT;
+			return (*fl_pte & 0xFFF00000) | (va & 0x000FFFFF);
+		}
+		/* all 16 copies must agree; check once per block */
+		first = fl_table + ((va >> 20) & ~15);
+		for (i = 0; IS_ALIGNED(va, SZ_16M) && i < 16; i++)
+			it_check(first[i] == *fl_pte,
+				 "16M at %#x: entry %d is %#lx, not %#lx",
+				 va, i, first[i], *fl_pte);
+		*type = IT_SUPER;
+		return (*fl_pte & 0xFF000000) | (va & 0x00FFFFFF);
+	}
+
+	sl_table = __va(*fl_pte & FL_BASE_MASK);
+	sl_pte = sl_table + ((va >> 12) & 0xFF);
+	if (!*sl_pte)
+		return 0;
+
+	if ((*sl_pte & 0x03) == SL_TYPE_LARGE) {
+		first = sl_table + (((va >> 12) & 0xFF) & ~15);
+		for (i = 0; IS_ALIGNED(va, SZ_64K) && i < 16; i++)
+			it_check(first[i] == *sl_pte,
+				 "64K at %#x: entry %d is %#lx, not %#lx",
+				 va, i, first[i], *sl_pte);
+		*type = IT_LARGE;
+		return (*sl_pte & SL_BASE_MASK_LARGE) | (va & 0xFFFF);
+	}
+
+	*type = IT_SMALL;
+	return (*sl_pte & SL_BASE_MASK_SMALL) | (va & 0xFFF);
+}
+
+/* every page of the chunks must translate, counting entries by type */
+static void it_check_mapped(unsigned int va, const struct it_chunk *chunks,
+			    int n, unsigned int *count)
+{
+	static const unsigned int span[IT_NR_TYPES] = {
+		SZ_16M, SZ_1M, SZ_64K, SZ_4K
+	};
+	unsigned int off, pa;
+	int i, type = IT_SMALL;
+
+	memset(count, 0, IT_NR_TYPES * sizeof(*count));
+	for (i = 0; i < n; i++) {
+		for (off = 0; off < chunks[i].len; off += SZ_4K, va += SZ_4K) {
+			pa = it_walk(va, &type);
+			it_check(pa == chunks[i].pa + off,
+				 "va %#x maps %#x, expected %#x", va, pa,
+				 chunks[i].pa + off);
+			if (IS_ALIGNED(va, span[type]))
+				count[type]++;
+		}
+	}
+}
+
+static void it_check_unmapped(unsigned int va, unsigned int len)
+{
+	unsigned int end = va + len;
+	int type;
+
+	for (; va != end; va += SZ_4K)
+		it_check(!it_walk(va, &type), "va %#x still mapped", va);
+}
+
+static void it_check_count(const unsigned int *count, unsigned int super,
+			   unsigned int sect, unsigned int large,
+			   unsigned int small)
+{
+	it_check(count[IT_SUPER] == super && count[IT_SECT] == sect &&
+		 count[IT_LARGE] == large && count[IT_SMALL] == small,
+		 "entries %u/%u/%u/%u (16M/1M/64K/4K), expected %u/%u/%u/%u",
+		 count[IT_SUPER], count[IT_SECT], count[IT_LARGE],
+		 count[IT_SMALL], super, sect, large, small);
+}
+
+/* one aligned chunk should use each entry size, largest first */
+static void it_test_sizes(struct iommu_domain *domain)
+{
+	const unsigned int va = 0x10000000;
+	const struct it_chunk c = {
+		0x41000000, 2 * SZ_16M + SZ_1M + SZ_64K + SZ_4K
+	};
+	unsigned int count[IT_NR_TYPES];
+
+	it_check(!it_map(domain, va, &c, 1), "map failed");
+	it_check_mapped(va, &c, 1, count);
+	it_check_count(count, 2, 1, 1, 1);
+
+	iommu_unmap_range(domain, va, c.len);
+	it_check_unmapped(va, c.len);
+	it_check(!fl_table[(va + c.len) >> 20],
+		 "empty 2nd level table left behind");
+}
+
+/* a misaligned physical address can only use 4K pages */
+static void it_test_misaligned(struct iommu_domain *domain)
+{
+	const unsigned int va = 0x10000000;
+	const struct it_chunk c = { 0x41001000, SZ_2M };
+	unsigned int count[IT_NR_TYPES];
+
+	it_check(!it_map(domain, va, &c, 1), "map failed");
+	it_check_mapped(va, &c, 1, count);
+	it_check_count(count, 0, 0, 0, SZ_2M / SZ_4K);
+
+	iommu_unmap_range(domain, va, c.len);
+	it_check_unmapped(va, c.len);
+}
+
+/* several sg chunks, each mapped with what its own alignment allows */
+static void it_test_sg(struct iommu_domain *domain)
+{
+	const unsigned int va = 0x20000000;
+	const struct it_chunk c[] = {
+		{ 0x42000000, SZ_1M },
+		{ 0x43010000, 3 * SZ_64K },
+		{ 0x44003000, 2 * SZ_4K },
+		{ 0x45000000, SZ_64K },
+		{ 0x46000000, SZ_8K },
+	};
+	unsigned int count[IT_NR_TYPES], len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(c); i++)
+		len += c[i].len;
+
+	it_check(!it_map(domain, va, c, ARRAY_SIZE(c)), "map failed");
+	it_check_mapped(va, c, ARRAY_SIZE(c), count);
+	/* 0x45000000 lands at a va that is only 8K aligned */
+	it_check_count(count, 0, 1, 3, 2 + 16 + 2);
+
+	iommu_unmap_range(domain, va, len);
+	it_check_unmapped(va, len);
+}
+
+/*
+ * Unmapping from the middle of a supersection must remove all 16 of its
+ * entries and nothing past it.
+ */
+static void it_test_unmap_super(struct iommu_domain *domain)
+{
+	const struct it_chunk before = { 0x46F00000, SZ_1M };
+	const struct it_chunk super = { 0x48000000, SZ_16M };
+	const struct it_chunk after = { 0x47000000, SZ_1M };
+	unsigned int count[IT_NR_TYPES];
+
+	it_check(!it_map(domain, 0x2FF00000, &before, 1), "map failed");
+	it_check(!it_map(domain, 0x30000000, &super, 1), "map failed");
+	it_check(!it_map(domain, 0x31000000, &after, 1), "map failed");
+
+	iommu_unmap_range(domain, 0x30400000, SZ_4M);
+
+	it_check_unmapped(0x30000000, SZ_16M);
+	it_check_mapped(0x2FF00000, &before, 1, count);
+	it_check_mapped(0x31000000, &after, 1, count);
+	it_check_count(count, 0, 1, 0, 0);
+
+	iommu_unmap_range(domain, 0x2FF00000, SZ_1M);
+	iommu_unmap_range(domain, 0x31000000, SZ_1M);
+	it_check_unmapped(0x2FF00000, SZ_16M + 2 * SZ_1M);
+}
+
+/* the same for a 64K page in a 2nd level table */
+static void it_test_unmap_large(struct iommu_domain *domain)
+{
+	const struct it_chunk large = { 0x49000000, 2 * SZ_64K };
+	const struct it_chunk rest = { 0x49010000, SZ_64K };
+	const struct it_chunk small = { 0x4A000000, SZ_4K };
+	unsigned int count[IT_NR_TYPES];
+
+	it_check(!it_map(domain, 0x40000000, &large, 1), "map failed");
+	it_check(!it_map(domain, 0x40020000, &small, 1), "map failed");
+
+	iommu_unmap_range(domain, 0x40004000, SZ_8K);
+
+	it_check_unmapped(0x40000000, SZ_64K);
+	it_check_mapped(0x40010000, &rest, 1, count);
+	it_check_count(count, 0, 0, 1, 0);
+	it_check_mapped(0x40020000, &small, 1, count);
+
+	iommu_unmap_range(domain, 0x40010000, SZ_64K + SZ_4K);
+	it_check_unmapped(0x40000000, SZ_1M);
+	it_check(!fl_table[0x400], "empty 2nd level table left behind");
+}
+
+/* a failed map removes what it wrote and leaves the blocker alone */
+static void it_test_map_fail(struct iommu_domain *domain)
+{
+	const struct it_chunk blocker = { 0x4B100000, SZ_1M };
+	const struct it_chunk c = { 0x4C000000, SZ_2M + SZ_64K };
+	unsigned int count[IT_NR_TYPES];
+	int ret;
+
+	it_check(!it_map(domain, 0x50100000, &blocker, 1), "map failed");
+
+	ret = it_map(domain, 0x50000000, &c, 1);
+	it_check(ret == -EBUSY, "mapping over a section gave %d", ret);
+	it_check_unmapped(0x50000000, SZ_1M);
+	it_check_mapped(0x50100000, &blocker, 1, count);
+
+	iommu_unmap_range(domain, 0x50100000, SZ_1M);
+	it_check_unmapped(0x50000000, c.len);
+}
+
+static struct it_chunk *it_bench_layout(unsigned int chunk, int *n)
+{
+	struct it_chunk *chunks;
+	unsigned int len = bench_mb << 20;
+	int i;
+
+	*n = len / chunk;
+	chunks = vmalloc(*n * sizeof(*chunks));
+	if (!chunks)
+		return NULL;
+
+	/* leave a hole after each chunk so they can't be merged */
+	for (i = 0; i < *n; i++) {
+		chunks[i].pa = 0x40000000 + i * 2 * chunk;
+		chunks[i].len = chunk;
+	}
+	return chunks;
+}
+
+static void it_bench(struct iommu_domain *domain, unsigned int chunk,
+		     const char *name)
+{
+	struct it_chunk *chunks;
+	s64 map_ns = 0, unmap_ns = 0;
+	unsigned int len = bench_mb << 20;
+	ktime_t t;
+	int i, n, ret;
+
+	chunks = it_bench_layout(chunk, &n);
+	if (!chunks) {
+		pr_err("iommu_test: no memory for the %s layout\n", name);
+		return;
+	}
+
+	for (i = 0; i < iterations; i++) {
+		t = ktime_get();
+		ret = it_map(domain, IT_BENCH_VA, chunks, n);
+		map_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+		if (ret) {
+			it_check(0, "%s: map failed: %d", name, ret);
+			break;
+		}
+
+		t = ktime_get();
+		iommu_unmap_range(domain, IT_BENCH_VA, len);
+		unmap_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+	}
+
+	pr_info("iommu_test: %s: map_range %lld us, unmap_range %lld us\n",
+		name, div_s64(map_ns, iterations * NSEC_PER_USEC),
+		div_s64(unmap_ns, iterations * NSEC_PER_USEC));
+	vfree(chunks);
+}
+
+/* the old way: one iommu_map() and one TLB flush per 4K page */
+static void it_bench_pages(struct iommu_domain *domain)
+{
+	unsigned int npages = (bench_mb << 20) / SZ_4K;
+	s64 map_ns = 0, unmap_ns = 0;
+	unsigned int p;
+	ktime_t t;
+	int i, ret = 0;
+
+	for (i = 0; i < iterations && !ret; i++) {
+		t = ktime_get();
+		for (p = 0; p < npages && !ret; p++)
+			ret = iommu_map(domain, IT_BENCH_VA + p * SZ_4K,
+					0x40000000 + p * 2 * SZ_4K, 0,
+					IT_PROT);
+		map_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+		it_check(!ret, "iommu_map failed: %d", ret);
+
+		t = ktime_get();
+		while (p--)
+			iommu_unmap(domain, IT_BENCH_VA + p * SZ_4K, 0);
+		unmap_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+	}
+
+	pr_info("iommu_test: 4K pages, one at a time: map %lld us, "
+		"unmap %lld us\n",
+		div_s64(map_ns, iterations * NSEC_PER_USEC),
+		div_s64(unmap_ns, iterations * NSEC_PER_USEC));
+}
+
+static int __init iommu_test_init(void)
+{
+	struct iommu_domain *domain;
+
+	if (!bench_mb || bench_mb > 256 || !iterations)
+		return -EINVAL;
+
+	domain = iommu_domain_alloc(0);
+	if (!domain) {
+		pr_err("iommu_test: cannot allocate a domain\n");
+		return -ENODEV;
+	}
+	fl_table = __va(iommu_get_pt_base_addr(domain));
+
+	it_test_sizes(domain);
+	it_test_misaligned(domain);
+	it_test_sg(domain);
+	it_test_unmap_super(domain);
+	it_test_unmap_large(domain);
+	it_test_map_fail(domain);
+
+	if (failures)
+		pr_err("iommu_test: %d check(s) failed\n", failures);
+	else
+		pr_info("iommu_test: all checks passed\n");
+
+	it_bench(domain, SZ_4K, "4K pages");
+	it_bench(domain, SZ_64K, "64K chunks");
+	it_bench(domain, SZ_1M, "1M chunks");
+	it_bench(domain, bench_mb << 20, "contiguous");
+	it_bench_pages(domain);
+
+	iommu_domain_free(domain);
+
+	/* Nothing to keep loaded, the results are in the log */
+	return -EAGAIN;
+}
+module_init(iommu_test_init);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("MSM IOMMU map_range self test and benchmark");
@@ -698,13 +698,141 @@ static unsigned int get_phys_addr(struct scatterlist *sg)
 	return pa;
 }
 
+/*
+ * The next @size bytes of a range can go into a single page table entry
+ * if both addresses are @size aligned and neither the current sg chunk
+ * nor the range ends before then.
+ */
+static inline int block_fits(unsigned int va, unsigned int pa,
+			     unsigned int chunk_left, unsigned int len_left,
+			     unsigned int size)
+{
+	return IS_ALIGNED(va, size) && IS_ALIGNED(pa, size) &&
+	       chunk_left >= size && len_left >= size;
+}
+
+static inline int fl_range_empty(unsigned long *fl_pte, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (fl_pte[i])
+			return 0;
+	return 1;
+}
+
+/*
+ * Clear the entries for [va, va + len) and free 2nd level tables that end
+ * up empty. Supersections and 64K pages are 16 copies of one entry and
+ * can't be split, so one the range only partly covers is removed whole.
+ * The caller holds msm_iommu_lock and flushes the TLB.
+ */
+static void __msm_iommu_unmap_range(struct msm_priv *priv, unsigned int va,
+				    unsigned int len)
+{
+	unsigned int offset = 0;
+	unsigned long *fl_table;
+	unsigned long *fl_pte;
+	unsigned long fl_offset;
+	unsigned long *sl_table;
+	unsigned long sl_start, sl_end;
+	unsigned long *first;
+	int used, i;
+
+	fl_table = priv->pgtable;
+
+	fl_offset = FL_OFFSET(va);	/* Upper 12 bits */
+	fl_pte = fl_table + fl_offset;	/* int pointers, 4 bytes */
+
+	sl_start = SL_OFFSET(va);
+
+	while (offset < len) {
+		/* Nothing mapped in this 1M block */
+		if (*fl_pte == 0) {
+			offset += (NUM_SL_PTE - sl_start) * SZ_4K;
+			fl_pte++;
+			sl_start = 0;
+			continue;
+		}
+
+		if (*fl_pte & FL_TYPE_SECT) {
+			first = fl_pte;
+			i = 1;
+			if (*fl_pte & FL_SUPERSECTION) {
+				first -= (fl_pte - fl_table) & 15;
+				i = 16;
+			}
+			memset(first, 0, i * sizeof(*first));
+			if (!priv->redirect)
+				clean_pte(first, first + i);
+
+			/* carry on after the block, wherever va fell in it */
+			offset += (first + i - fl_pte) * SZ_1M -
+				  sl_start * SZ_4K;
+			fl_pte = first + i;
+			sl_start = 0;
+			continue;
+		}
+
+		sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
+		sl_end = ((len - offset) / SZ_4K) + sl_start;
+
+		if (sl_end > NUM_SL_PTE)
+			sl_end = NUM_SL_PTE;
+
+		offset += (sl_end - sl_start) * SZ_4K;
+
+		/* widen to whole 64K pages at either end */
+		if ((sl_table[sl_start] & 0x03) == SL_TYPE_LARGE)
+			sl_start = round_down(sl_start, 16);
+		if ((sl_table[sl_end - 1] & 0x03) == SL_TYPE_LARGE)
+			sl_end = round_up(sl_end, 16);
+
+		memset(sl_table + sl_start, 0, (sl_end - sl_start) * 4);
+		if (!priv->redirect)
+			clean_pte(sl_table + sl_start, sl_table + sl_end);
+
+		/* Unmap and free the 2nd level table if all mappings in it
+		 * were removed. This saves memory, but the table will need
+		 * to be re-allocated the next time someone tries to map these
+		 * VAs.
+		 */
+		used = 0;
+
+		/* If we just unmapped the whole table, don't bother
+		 * seeing if there are still used entries left.
+		 */
+		if (sl_end - sl_start != NUM_SL_PTE)
+			for (i = 0; i < NUM_SL_PTE; i++)
+				if (sl_table[i]) {
+					used = 1;
+					break;
+				}
+		if (!used) {
+			free_page((unsigned long)sl_table);
+			*fl_pte = 0;
+
+			if (!priv->redirect)
+				clean_pte(fl_pte, fl_pte + 1);
+		}
+
+		sl_start = 0;
+		fl_pte++;
+	}
+}
+
+/*
+ * Map a scatterlist using the largest entries (16M supersection, 1M
+ * section, 64K large page, 4K small page) that the physical layout and
+ * alignment allow. The TLB is invalidated once for the whole range.
+ */
 static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 			       struct scatterlist *sg, unsigned int len,
 			       int prot)
 {
 	unsigned int pa;
 	unsigned int offset = 0;
-	unsigned int pgprot;
+	unsigned int pgprot, pgprot_sect;
 	unsigned long *fl_table;
 	unsigned long *fl_pte;
 	unsigned long fl_offset;
@@ -712,7 +840,8 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	unsigned long sl_offset, sl_start;
 	unsigned int chunk_offset = 0;
 	unsigned int chunk_pa;
-	int ret = 0;
+	unsigned int size;
+	int i, ret = 0;
 	struct msm_priv *priv;
 
 	mutex_lock(&msm_iommu_lock);
@@ -723,8 +852,9 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	fl_table = priv->pgtable;
 
 	pgprot = __get_pgprot(prot, SZ_4K);
+	pgprot_sect = __get_pgprot(prot, SZ_1M);
 
-	if (!pgprot) {
+	if (!pgprot || !pgprot_sect) {
 		ret = -EINVAL;
 		goto fail;
 	}
@@ -732,7 +862,6 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	fl_offset = FL_OFFSET(va);	/* Upper 12 bits */
 	fl_pte = fl_table + fl_offset;	/* int pointers, 4 bytes */
 
-	sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
 	sl_offset = SL_OFFSET(va);
 
 	chunk_pa = get_phys_addr(sg);
@@ -743,6 +872,51 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	}
 
 	while (offset < len) {
+		pa = chunk_pa + chunk_offset;
+
+		/* Whole 1M (or 16M) blocks go straight into the 1st level */
+		if (*fl_pte == 0 && block_fits(va + offset, pa,
+				sg->length - chunk_offset, len - offset,
+				SZ_1M)) {
+			if (block_fits(va + offset, pa,
+				       sg->length - chunk_offset,
+				       len - offset, SZ_16M) &&
+			    fl_range_empty(fl_pte, 16)) {
+				for (i = 0; i < 16; i++)
+					fl_pte[i] = (pa & 0xFF000000) |
+						FL_SUPERSECTION | FL_AP_READ |
+						FL_AP_WRITE | FL_TYPE_SECT |
+						FL_SHARED | FL_NG | pgprot_sect;
+				size = SZ_16M;
+			} else {
+				*fl_pte = (pa & 0xFFF00000) | FL_AP_READ |
+					  FL_AP_WRITE | FL_NG | FL_TYPE_SECT |
+					  FL_SHARED | pgprot_sect;
+				size = SZ_1M;
+			}
+
+			if (!priv->redirect)
+				clean_pte(fl_pte, fl_pte + (size >> 20));
+
+			fl_pte += size >> 20;
+			offset += size;
+			chunk_offset += size;
+			sl_offset = 0;
+
+			if (chunk_offset >= sg->length && offset < len) {
+				chunk_offset = 0;
+				sg = sg_next(sg);
+				chunk_pa = get_phys_addr(sg);
+				if (chunk_pa == 0) {
+					pr_debug("No dma address for sg %p\n",
+						 sg);
+					ret = -EINVAL;
+					goto fail;
+				}
+			}
+			continue;
+		}
+
 		/* Set up a 2nd level page table if one doesn't exist */
 		if (*fl_pte == 0) {
 			sl_table = (unsigned long *)
@@ -759,6 +933,11 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 							    FL_TYPE_TABLE);
 			if (!priv->redirect)
 				clean_pte(fl_pte, fl_pte + 1);
+		} else if (*fl_pte & FL_TYPE_SECT) {
+			pr_debug("va %x already mapped by a section\n",
+				 va + offset);
+			ret = -EBUSY;
+			goto fail;
 		} else
 			sl_table = (unsigned long *)
 					       __va(((*fl_pte) & FL_BASE_MASK));
@@ -771,13 +950,29 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 		/* Build the 2nd level page table */
 		while (offset < len && sl_offset < NUM_SL_PTE) {
 			pa = chunk_pa + chunk_offset;
-			sl_table[sl_offset] = (pa & SL_BASE_MASK_SMALL) |
-					      pgprot | SL_AP0 | SL_AP1 | SL_NG |
-					      SL_SHARED | SL_TYPE_SMALL;
-			sl_offset++;
-			offset += SZ_4K;
 
-			chunk_offset += SZ_4K;
+			if (block_fits(va + offset, pa,
+				       sg->length - chunk_offset,
+				       len - offset, SZ_64K)) {
+				for (i = 0; i < 16; i++)
+					sl_table[sl_offset + i] =
+						(pa & SL_BASE_MASK_LARGE) |
+						pgprot | SL_AP0 | SL_AP1 |
+						SL_NG | SL_SHARED |
+						SL_TYPE_LARGE;
+				size = SZ_64K;
+			} else {
+				sl_table[sl_offset] =
+						(pa & SL_BASE_MASK_SMALL) |
+						pgprot | SL_AP0 | SL_AP1 |
+						SL_NG | SL_SHARED |
+						SL_TYPE_SMALL;
+				size = SZ_4K;
+			}
+			sl_offset += size >> 12;
+			offset += size;
+
+			chunk_offset += size;
 
 			if (chunk_offset >= sg->length && offset < len) {
 				chunk_offset = 0;
@@ -799,76 +994,30 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 		sl_offset = 0;
 	}
 	__flush_iotlb(domain);
+	mutex_unlock(&msm_iommu_lock);
+	return 0;
+
 fail:
+	/*
+	 * Undo only what this call wrote: anything past @offset belonged to
+	 * someone else (e.g. the section that made us fail with -EBUSY).
+	 */
+	if (offset) {
+		__msm_iommu_unmap_range(priv, va, offset);
+		__flush_iotlb(domain);
+	}
 	mutex_unlock(&msm_iommu_lock);
 	return ret;
 }
 
-
 static int msm_iommu_unmap_range(struct iommu_domain *domain, unsigned int va,
 				 unsigned int len)
 {
-	unsigned int offset = 0;
-	unsigned long *fl_table;
-	unsigned long *fl_pte;
-	unsigned long fl_offset;
-	unsigned long *sl_table;
-	unsigned long sl_start, sl_end;
-	int used, i;
-	struct msm_priv *priv;
-
 	mutex_lock(&msm_iommu_lock);
 
 	BUG_ON(len & (SZ_4K - 1));
 
-	priv = domain->priv;
-	fl_table = priv->pgtable;
-
-	fl_offset = FL_OFFSET(va);	/* Upper 12 bits */
-	fl_pte = fl_table + fl_offset;	/* int pointers, 4 bytes */
-
-	sl_start = SL_OFFSET(va);
-
-	while (offset < len) {
-		sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
-		sl_end = ((len - offset) / SZ_4K) + sl_start;
-
-		if (sl_end > NUM_SL_PTE)
-			sl_end = NUM_SL_PTE;
-
-		memset(sl_table + sl_start, 0, (sl_end - sl_start) * 4);
-		if (!priv->redirect)
-			clean_pte(sl_table + sl_start, sl_table + sl_end);
-
-		offset += (sl_end - sl_start) * SZ_4K;
-
-		/* Unmap and free the 2nd level table if all mappings in it
-		 * were removed. This saves memory, but the table will need
-		 * to be re-allocated the next time someone tries to map these
-		 * VAs.
-		 */
-		used = 0;
-
-		/* If we just unmapped the whole table, don't bother
-		 * seeing if there are still used entries left.
-		 */
-		if (sl_end - sl_start != NUM_SL_PTE)
-			for (i = 0; i < NUM_SL_PTE; i++)
-				if (sl_table[i]) {
-					used = 1;
-					break;
-				}
-		if (!used) {
-			free_page((unsigned long)sl_table);
-			*fl_pte = 0;
-
-			if (!priv->redirect)
-				clean_pte(fl_pte, fl_pte + 1);
-		}
-
-		sl_start = 0;
-		fl_pte++;
-	}
+	__msm_iommu_unmap_range(domain->priv, va, len);
 
 	__flush_iotlb(domain);
 	mutex_unlock(&msm_iommu_lock);
@@ -14,6 +14,8 @@
 #include <linux/memory_alloc.h>
 #include <linux/iommu.h>
 #include <linux/vmalloc.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
 #include <asm/sizes.h>
 #include <asm/page.h>
 #include <linux/init.h>
@@ -185,6 +187,13 @@ static struct msm_iommu_domain msm_iommu_domains[] = {
 		},
 };
 
+/*
+ * Every page of the overmapping points at the same dummy block, so build
+ * a scatterlist of it and map the whole thing with one map_range call:
+ * the page tables are written in one pass and the TLB is invalidated
+ * once instead of once per page. On failure map_range has already
+ * removed the entries it wrote, and only those.
+ */
 int msm_iommu_map_extra(struct iommu_domain *domain,
 				unsigned long start_iova,
 				unsigned long size,
@@ -192,28 +201,33 @@ int msm_iommu_map_extra(struct iommu_domain *domain,
 				int cached)
 {
 	int i, ret_value = 0;
-	unsigned long order = get_order(page_size);
 	unsigned long aligned_size = ALIGN(size, page_size);
-	unsigned long nrpages = aligned_size >> (PAGE_SHIFT + order);
+	unsigned long nrpages = aligned_size >> (PAGE_SHIFT +
+						 get_order(page_size));
 	unsigned long phy_addr = ALIGN(virt_to_phys(iommu_dummy), page_size);
-	unsigned long temp_iova = start_iova;
-
-	for (i = 0; i < nrpages; i++) {
-		int ret = iommu_map(domain, temp_iova, phy_addr, order, cached);
-		if (ret) {
-			pr_err("%s: could not map %lx in domain %p, error: %d\n",
-				__func__, start_iova, domain, ret);
-			ret_value = -EAGAIN;
-			goto out;
-		}
-		temp_iova += page_size;
+	struct sg_table table;
+	struct scatterlist *sg;
+
+	if (!nrpages)
+		return 0;
+
+	if (sg_alloc_table(&table, nrpages, GFP_KERNEL))
+		return -ENOMEM;
+
+	for_each_sg(table.sgl, sg, table.nents, i) {
+		sg_dma_address(sg) = phy_addr;
+		sg->length = page_size;
 	}
-	return ret_value;
-out:
-	for (; i > 0; --i) {
-		temp_iova -= page_size;
-		iommu_unmap(domain, start_iova, order);
+
+	ret_value = iommu_map_range(domain, start_iova, table.sgl,
+				    aligned_size, cached);
+	if (ret_value) {
+		pr_err("%s: could not map %lx in domain %p, error: %d\n",
+			__func__, start_iova, domain, ret_value);
+		ret_value = -EAGAIN;
 	}
+
+	sg_free_table(&table);
 	return ret_value;
 }
 
@@ -222,19 +236,9 @@ void msm_iommu_unmap_extra(struct iommu_domain *domain,
 				unsigned long size,
 				unsigned long page_size)
 {
-	int i;
-	unsigned long order = get_order(page_size);
-	unsigned long aligned_size = ALIGN(size, page_size);
-	unsigned long nrpages =  aligned_size >> (PAGE_SHIFT + order);
-	unsigned long temp_iova = start_iova;
-
-	for (i = 0; i < nrpages; ++i) {
-		iommu_unmap(domain, temp_iova, order);
-		temp_iova += page_size;
-	}
+	iommu_unmap_range(domain, start_iova, ALIGN(size, page_size));
 }
 
-
 struct iommu_domain *msm_get_iommu_domain(int domain_num)
 {
 	if (domain_num >= 0 && domain_num < MAX_DOMAINS)
@@ -27,6 +27,7 @@
 #include <linux/platform_device.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/rculist.h>
 
 #include <asm/uaccess.h>
 #include <asm/byteorder.h>
@@ -89,6 +90,12 @@ if (msm_ipc_router_debug_mask & R2R_RAW_HDR) \
 #define IPC_ROUTER_LOG_EVENT_TX         0x11
 #define IPC_ROUTER_LOG_EVENT_RX         0x12
 
+/*
+ * The local port, server and routing tables are RCU protected.  Lookups
+ * walk the hash chains under rcu_read_lock() only; the mutexes below
+ * serialize updaters, which must use the _rcu list primitives and defer
+ * freeing of entries until after a grace period.
+ */
 static LIST_HEAD(control_ports);
 static DEFINE_MUTEX(control_ports_lock);
 
@@ -105,12 +112,14 @@ struct msm_ipc_server {
 	struct list_head list;
 	struct msm_ipc_port_name name;
 	struct list_head server_port_list;
+	struct rcu_head rcu;
 };
 
 struct msm_ipc_server_port {
 	struct list_head list;
 	struct msm_ipc_port_addr server_addr;
 	struct msm_ipc_router_xprt_info *xprt_info;
+	struct rcu_head rcu;
 };
 
 #define RP_HASH_SIZE 32
@@ -122,6 +131,7 @@ struct msm_ipc_router_remote_port {
 	wait_queue_head_t quota_wait;
 	uint32_t tx_quota_cnt;
 	struct mutex quota_lock;
+	struct rcu_head rcu;
 };
 
 struct msm_ipc_router_xprt_info {
@@ -236,18 +246,21 @@ static int add_routing_table_entry(
 		return -EINVAL;
 
 	key = (rt_entry->node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 	return 0;
 }
 
-/*Please take routing_table_lock before calling this function*/
+/*
+ * Please take routing_table_lock or rcu_read_lock before calling this
+ * function.  Routing table entries are never freed once added.
+ */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	uint32_t node_id)
 {
 	uint32_t key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
 		if (rt_entry->node_id == node_id)
 			return rt_entry;
 	}
@@ -428,7 +441,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	mutex_lock(&local_ports_lock);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	mutex_unlock(&local_ports_lock);
 }
 
@@ -477,14 +490,14 @@ static struct msm_ipc_port *msm_ipc_router_lookup_local_port(uint32_t port_id)
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	mutex_lock(&local_ports_lock);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
 		if (port_ptr->this_port.port_id == port_id) {
-			mutex_unlock(&local_ports_lock);
+			rcu_read_unlock();
 			return port_ptr;
 		}
 	}
-	mutex_unlock(&local_ports_lock);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -496,27 +509,24 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_lookup_remote_port(
 	struct msm_ipc_routing_table_entry *rt_entry;
 	int key = (port_id & (RP_HASH_SIZE - 1));
 
-	mutex_lock(&routing_table_lock);
+	rcu_read_lock();
 	rt_entry = lookup_routing_table(node_id);
 	if (!rt_entry) {
-		mutex_unlock(&routing_table_lock);
+		rcu_read_unlock();
 		pr_err("%s: Node is not up\n", __func__);
 		return NULL;
 	}
 
-	mutex_lock(&rt_entry->lock);
-	list_for_each_entry(rport_ptr,
+	list_for_each_entry_rcu(rport_ptr,
 			    &rt_entry->remote_port_list[key], list) {
 		if (rport_ptr->port_id == port_id) {
 			if (rport_ptr->restart_state != RESTART_NORMAL)
 				rport_ptr = NULL;
-			mutex_unlock(&rt_entry->lock);
-			mutex_unlock(&routing_table_lock);
+			rcu_read_unlock();
 			return rport_ptr;
 		}
 	}
-	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -551,7 +561,7 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_create_remote_port(
 	rport_ptr->tx_quota_cnt = 0;
 	init_waitqueue_head(&rport_ptr->quota_wait);
 	mutex_init(&rport_ptr->quota_lock);
-	list_add_tail(&rport_ptr->list,
+	list_add_tail_rcu(&rport_ptr->list,
 		      &rt_entry->remote_port_list[key]);
 	mutex_unlock(&rt_entry->lock);
 	mutex_unlock(&routing_table_lock);
@@ -577,8 +587,8 @@ static void msm_ipc_router_destroy_remote_port(
 	}
 
 	mutex_lock(&rt_entry->lock);
-	list_del(&rport_ptr->list);
-	kfree(rport_ptr);
+	list_del_rcu(&rport_ptr->list);
+	kfree_rcu(rport_ptr, rcu);
 	mutex_unlock(&rt_entry->lock);
 	mutex_unlock(&routing_table_lock);
 	return;
@@ -594,25 +604,25 @@ static struct msm_ipc_server *msm_ipc_router_lookup_server(
 	struct msm_ipc_server_port *server_port;
 	int key = (instance & (SRV_HASH_SIZE - 1));
 
-	mutex_lock(&server_list_lock);
-	list_for_each_entry(server, &server_list[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(server, &server_list[key], list) {
 		if ((server->name.service != service) ||
 		    (server->name.instance != instance))
 			continue;
 		if ((node_id == 0) && (port_id == 0)) {
-			mutex_unlock(&server_list_lock);
+			rcu_read_unlock();
 			return server;
 		}
-		list_for_each_entry(server_port, &server->server_port_list,
-				    list) {
+		list_for_each_entry_rcu(server_port,
+					&server->server_port_list, list) {
 			if ((server_port->server_addr.node_id == node_id) &&
 			    (server_port->server_addr.port_id == port_id)) {
-				mutex_unlock(&server_list_lock);
+				rcu_read_unlock();
 				return server;
 			}
 		}
 	}
-	mutex_unlock(&server_list_lock);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -643,14 +653,14 @@ static struct msm_ipc_server *msm_ipc_router_create_server(
 	server->name.service = service;
 	server->name.instance = instance;
 	INIT_LIST_HEAD(&server->server_port_list);
-	list_add_tail(&server->list, &server_list[key]);
+	list_add_tail_rcu(&server->list, &server_list[key]);
 
 create_srv_port:
 	server_port = kmalloc(sizeof(struct msm_ipc_server_port), GFP_KERNEL);
 	if (!server_port) {
 		if (list_empty(&server->server_port_list)) {
-			list_del(&server->list);
-			kfree(server);
+			list_del_rcu(&server->list);
+			kfree_rcu(server, rcu);
 		}
 		mutex_unlock(&server_list_lock);
 		pr_err("%s: Server Port allocation failed\n", __func__);
@@ -659,7 +669,7 @@ create_srv_port:
 	server_port->server_addr.node_id = node_id;
 	server_port->server_addr.port_id = port_id;
 	server_port->xprt_info = xprt_info;
-	list_add_tail(&server_port->list, &server->server_port_list);
+	list_add_tail_rcu(&server_port->list, &server->server_port_list);
 	mutex_unlock(&server_list_lock);
 
 	return server;
@@ -680,12 +690,12 @@ static void msm_ipc_router_destroy_server(struct msm_ipc_server *server,
 			break;
 	}
 	if (server_port) {
-		list_del(&server_port->list);
-		kfree(server_port);
+		list_del_rcu(&server_port->list);
+		kfree_rcu(server_port, rcu);
 	}
 	if (list_empty(&server->server_port_list)) {
-		list_del(&server->list);
-		kfree(server);
+		list_del_rcu(&server->list);
+		kfree_rcu(server, rcu);
 	}
 	mutex_unlock(&server_list_lock);
 	return;
@@ -1048,12 +1058,12 @@ static void msm_ipc_cleanup_remote_server_info(
 				ctl.srv.port_id = svr_port->server_addr.port_id;
 				relay_ctl_msg(xprt_info, &ctl);
 				broadcast_ctl_msg_locally(&ctl);
-				list_del(&svr_port->list);
-				kfree(svr_port);
+				list_del_rcu(&svr_port->list);
+				kfree_rcu(svr_port, rcu);
 			}
 			if (list_empty(&svr->server_port_list)) {
-				list_del(&svr->list);
-				kfree(svr);
+				list_del_rcu(&svr->list);
+				kfree_rcu(svr, rcu);
 			}
 		}
 	}
@@ -1122,8 +1132,8 @@ static void msm_ipc_cleanup_remote_port_info(uint32_t node_id)
 				list_for_each_entry_safe(rport_ptr,
 					tmp_rport_ptr,
 					&rt_entry->remote_port_list[j], list) {
-					list_del(&rport_ptr->list);
-					kfree(rport_ptr);
+					list_del_rcu(&rport_ptr->list);
+					kfree_rcu(rport_ptr, rcu);
 				}
 			}
 			mutex_unlock(&rt_entry->lock);
@@ -1970,11 +1980,11 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 				port_ptr->this_port.node_id,
 				port_ptr->this_port.port_id);
 		mutex_lock(&local_ports_lock);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		mutex_unlock(&local_ports_lock);
 	} else if (port_ptr->type == CLIENT_PORT) {
 		mutex_lock(&local_ports_lock);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		mutex_unlock(&local_ports_lock);
 	} else if (port_ptr->type == CONTROL_PORT) {
 		mutex_lock(&control_ports_lock);
@@ -1983,7 +1993,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 	}
 
 	wake_lock_destroy(&port_ptr->port_rx_wake_lock);
-	kfree(port_ptr);
+	kfree_rcu(port_ptr, rcu);
 	return 0;
 }
 
@@ -2012,8 +2022,10 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	mutex_lock(&local_ports_lock);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	mutex_unlock(&local_ports_lock);
+	/* let lookups drain off the local port chain before relinking */
+	synchronize_rcu();
 	port_ptr->type = CONTROL_PORT;
 	mutex_lock(&control_ports_lock);
 	list_add_tail(&port_ptr->list, &control_ports);
@@ -133,6 +133,7 @@ struct msm_ipc_port {
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
 	void *priv;
+	struct rcu_head rcu;
 };
 
 struct msm_ipc_sock {
@@ -99,7 +99,7 @@ static int subsys_q6_ramdump(int enable,
 				const struct subsys_data *crashed_subsys)
 {
 	if (enable)
-		return do_ramdump(q6_ramdump_dev, q6_segments,
+		return do_elf_ramdump(q6_ramdump_dev, q6_segments,
 				ARRAY_SIZE(q6_segments));
 	else
 		return 0;
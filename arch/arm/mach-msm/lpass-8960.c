@@ -121,7 +121,7 @@ static int lpass_ramdump(int enable, const struct subsys_data *subsys)
 {
 	pr_debug("%s: enable[%d]\n", __func__, enable);
 	if (enable)
-		return do_ramdump(lpass_ssr_8960.lpass_ramdump_dev,
+		return do_elf_ramdump(lpass_ssr_8960.lpass_ramdump_dev,
 				q6_segments,
 				ARRAY_SIZE(q6_segments));
 	else
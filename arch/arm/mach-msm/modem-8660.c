@@ -196,7 +196,7 @@ static int modem_ramdump(int enable,
 				const struct subsys_data *crashed_subsys)
 {
 	if (enable)
-		return do_ramdump(modem_ramdump_dev, modem_segments,
+		return do_elf_ramdump(modem_ramdump_dev, modem_segments,
 			ARRAY_SIZE(modem_segments));
 	else
 		return 0;
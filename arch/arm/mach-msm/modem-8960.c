@@ -193,7 +193,7 @@ static int modem_ramdump(int enable,
 	int ret = 0;
 
 	if (enable) {
-		ret = do_ramdump(modemsw_ramdump_dev, modemsw_segments,
+		ret = do_elf_ramdump(modemsw_ramdump_dev, modemsw_segments,
 			ARRAY_SIZE(modemsw_segments));
 
 		if (ret < 0) {
@@ -202,7 +202,7 @@ static int modem_ramdump(int enable,
 			goto out;
 		}
 
-		ret = do_ramdump(modemfw_ramdump_dev, modemfw_segments,
+		ret = do_elf_ramdump(modemfw_ramdump_dev, modemfw_segments,
 			ARRAY_SIZE(modemfw_segments));
 
 		if (ret < 0) {
@@ -211,7 +211,7 @@ static int modem_ramdump(int enable,
 			goto out;
 		}
 
-		ret = do_ramdump(smem_ramdump_dev, smem_segments,
+		ret = do_elf_ramdump(smem_ramdump_dev, smem_segments,
 			ARRAY_SIZE(smem_segments));
 
 		if (ret < 0) {
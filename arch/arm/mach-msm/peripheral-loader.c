@@ -22,19 +22,62 @@
 #include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/rwsem.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
 
 #include "peripheral-loader.h"
 
+/**
+ * struct pil_stats - timing of the last image load, in microseconds
+ * @mdt: fetching the metadata (.mdt) file
+ * @init_image: the init_image() op
+ * @fetch_wait: time spent stalled waiting for segment blobs to arrive
+ * @copy: copying and zero-filling segments into memory
+ * @verify: the verify_blob() op for all segments
+ * @auth_and_reset: the auth_and_reset() op
+ * @total: the whole load
+ * @bytes: number of bytes copied from blobs
+ * @segments: number of loadable segments
+ */
+struct pil_stats {
+	s64 mdt;
+	s64 init_image;
+	s64 fetch_wait;
+	s64 copy;
+	s64 verify;
+	s64 auth_and_reset;
+	s64 total;
+	size_t bytes;
+	unsigned segments;
+};
+
 struct pil_device {
 	struct pil_desc *desc;
 	int count;
 	struct mutex lock;
 	struct list_head list;
+	struct pil_stats stats;
 };
 
+/*
+ * Segment blobs are fetched one ahead of the segment being copied so that
+ * reading the next blob from storage overlaps the copy and verification of
+ * the current one.
+ */
+struct pil_fetch {
+	const struct firmware *fw;
+	struct completion done;
+	int pending;
+};
+
+static s64 pil_us_since(ktime_t start)
+{
+	return ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
 static DEFINE_MUTEX(pil_list_lock);
 static LIST_HEAD(pil_list);
 
@@ -64,13 +107,71 @@ static struct pil_device *find_peripheral(const char *str)
 
 #define IOMAP_SIZE SZ_4M
 
+static void pil_blob_name(struct pil_device *pil, unsigned num, char *buf,
+		size_t len)
+{
+	snprintf(buf, len, "%s.b%02d", pil->desc->name, num);
+}
+
+static void pil_fetch_done(const struct firmware *fw, void *context)
+{
+	struct pil_fetch *f = context;
+
+	f->fw = fw;
+	complete(&f->done);
+}
+
+static int pil_fetch_start(const struct elf32_phdr *phdr, unsigned num,
+		struct pil_device *pil, struct pil_fetch *f)
+{
+	char fw_name[30];
+	int ret;
+
+	f->fw = NULL;
+	f->pending = 0;
+	if (!phdr->p_filesz)
+		return 0;
+
+	init_completion(&f->done);
+	pil_blob_name(pil, num, fw_name, sizeof(fw_name));
+	ret = request_firmware_nowait(THIS_MODULE, FW_ACTION_HOTPLUG, fw_name,
+			pil->desc->dev, GFP_KERNEL, f, pil_fetch_done);
+	if (ret) {
+		dev_err(pil->desc->dev, "Failed to request blob %s\n",
+				fw_name);
+		return ret;
+	}
+	f->pending = 1;
+	return 0;
+}
+
+static void pil_fetch_finish(struct pil_device *pil, struct pil_fetch *f)
+{
+	ktime_t start;
+
+	if (!f->pending)
+		return;
+
+	start = ktime_get();
+	wait_for_completion(&f->done);
+	f->pending = 0;
+	pil->stats.fetch_wait += pil_us_since(start);
+}
+
+static void pil_fetch_release(struct pil_device *pil, struct pil_fetch *f)
+{
+	pil_fetch_finish(pil, f);
+	release_firmware(f->fw);
+	f->fw = NULL;
+}
+
 static int load_segment(const struct elf32_phdr *phdr, unsigned num,
-		struct pil_device *pil)
+		struct pil_device *pil, const struct firmware *fw)
 {
-	int ret, count, paddr;
+	int ret = 0, count, paddr;
 	char fw_name[30];
-	const struct firmware *fw = NULL;
 	const u8 *data;
+	ktime_t start;
 
 	if (memblock_is_region_memory(phdr->p_paddr, phdr->p_memsz)) {
 		dev_err(pil->desc->dev, "Kernel memory would be overwritten");
@@ -78,25 +179,23 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 	}
 
 	if (phdr->p_filesz) {
-		snprintf(fw_name, ARRAY_SIZE(fw_name), "%s.b%02d",
-				pil->desc->name, num);
-		ret = request_firmware(&fw, fw_name, pil->desc->dev);
-		if (ret) {
+		if (!fw) {
+			pil_blob_name(pil, num, fw_name, sizeof(fw_name));
 			dev_err(pil->desc->dev, "Failed to locate blob %s\n",
 					fw_name);
-			return ret;
+			return -ENOENT;
 		}
 
 		if (fw->size != phdr->p_filesz) {
 			dev_err(pil->desc->dev,
 				"Blob size %u doesn't match %u\n", fw->size,
 				phdr->p_filesz);
-			ret = -EPERM;
-			goto release_fw;
+			return -EPERM;
 		}
 	}
 
 	/* Load the segment into memory */
+	start = ktime_get();
 	count = phdr->p_filesz;
 	paddr = phdr->p_paddr;
 	data = fw ? fw->data : NULL;
@@ -108,8 +207,7 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		buf = ioremap(paddr, size);
 		if (!buf) {
 			dev_err(pil->desc->dev, "Failed to map memory\n");
-			ret = -ENOMEM;
-			goto release_fw;
+			return -ENOMEM;
 		}
 		memcpy(buf, data, size);
 		iounmap(buf);
@@ -129,8 +227,7 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		buf = ioremap(paddr, size);
 		if (!buf) {
 			dev_err(pil->desc->dev, "Failed to map memory\n");
-			ret = -ENOMEM;
-			goto release_fw;
+			return -ENOMEM;
 		}
 		memset(buf, 0, size);
 		iounmap(buf);
@@ -138,14 +235,16 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		count -= size;
 		paddr += size;
 	}
+	pil->stats.copy += pil_us_since(start);
+	pil->stats.bytes += phdr->p_filesz;
 
+	start = ktime_get();
 	ret = pil->desc->ops->verify_blob(pil->desc, phdr->p_paddr,
 					  phdr->p_memsz);
+	pil->stats.verify += pil_us_since(start);
 	if (ret)
 		dev_err(pil->desc->dev, "Blob %u failed verification\n", num);
 
-release_fw:
-	release_firmware(fw);
 	return ret;
 }
 
@@ -159,13 +258,28 @@ static int segment_is_loadable(const struct elf32_phdr *p)
 /* Sychronize request_firmware() with suspend */
 static DECLARE_RWSEM(pil_pm_rwsem);
 
+/* Index of the next loadable segment at or after @i, or @phnum if none */
+static int next_loadable(const struct elf32_phdr *phdr, int i, int phnum)
+{
+	for (; i < phnum; i++)
+		if (segment_is_loadable(&phdr[i]))
+			break;
+	return i;
+}
+
 static int load_image(struct pil_device *pil)
 {
-	int i, ret;
+	int i, next, ret;
 	char fw_name[30];
 	struct elf32_hdr *ehdr;
 	const struct elf32_phdr *phdr;
 	const struct firmware *fw;
+	struct pil_fetch fetch[2];
+	struct pil_fetch *cur, *ahead;
+	ktime_t start, stage;
+
+	memset(&pil->stats, 0, sizeof(pil->stats));
+	start = stage = ktime_get();
 
 	down_read(&pil_pm_rwsem);
 	snprintf(fw_name, sizeof(fw_name), "%s.mdt", pil->desc->name);
@@ -174,6 +288,7 @@ static int load_image(struct pil_device *pil)
 		dev_err(pil->desc->dev, "Failed to locate %s\n", fw_name);
 		goto out;
 	}
+	pil->stats.mdt = pil_us_since(stage);
 
 	if (fw->size < sizeof(*ehdr)) {
 		dev_err(pil->desc->dev, "Not big enough to be an elf header\n");
@@ -200,36 +315,72 @@ static int load_image(struct pil_device *pil)
 		goto release_fw;
 	}
 
+	phdr = (const struct elf32_phdr *)(fw->data + sizeof(struct elf32_hdr));
+	cur = &fetch[0];
+	ahead = &fetch[1];
+	cur->pending = ahead->pending = 0;
+	cur->fw = ahead->fw = NULL;
+
+	/* Start pulling in the first blob while the metadata is checked */
+	i = next_loadable(phdr, 0, ehdr->e_phnum);
+	if (i < ehdr->e_phnum) {
+		ret = pil_fetch_start(&phdr[i], i, pil, cur);
+		if (ret)
+			goto release_fw;
+	}
+
+	stage = ktime_get();
 	ret = pil->desc->ops->init_image(pil->desc, fw->data, fw->size);
+	pil->stats.init_image = pil_us_since(stage);
 	if (ret) {
 		dev_err(pil->desc->dev, "Invalid firmware metadata\n");
-		goto release_fw;
+		goto release_blobs;
 	}
 
-	phdr = (const struct elf32_phdr *)(fw->data + sizeof(struct elf32_hdr));
-	for (i = 0; i < ehdr->e_phnum; i++, phdr++) {
-		if (!segment_is_loadable(phdr))
-			continue;
+	while (i < ehdr->e_phnum) {
+		struct pil_fetch *tmp;
 
-		ret = load_segment(phdr, i, pil);
+		next = next_loadable(phdr, i + 1, ehdr->e_phnum);
+		if (next < ehdr->e_phnum) {
+			ret = pil_fetch_start(&phdr[next], next, pil, ahead);
+			if (ret)
+				goto release_blobs;
+		}
+
+		pil_fetch_finish(pil, cur);
+		ret = load_segment(&phdr[i], i, pil, cur->fw);
+		pil_fetch_release(pil, cur);
 		if (ret) {
 			dev_err(pil->desc->dev, "Failed to load segment %d\n",
 					i);
-			goto release_fw;
+			goto release_blobs;
 		}
+		pil->stats.segments++;
+
+		tmp = cur;
+		cur = ahead;
+		ahead = tmp;
+		i = next;
 	}
 
+	stage = ktime_get();
 	ret = pil->desc->ops->auth_and_reset(pil->desc);
+	pil->stats.auth_and_reset = pil_us_since(stage);
 	if (ret) {
 		dev_err(pil->desc->dev, "Failed to bring out of reset\n");
 		goto release_fw;
 	}
 	dev_info(pil->desc->dev, "brought out of reset\n");
+	goto release_fw;
 
+release_blobs:
+	pil_fetch_release(pil, cur);
+	pil_fetch_release(pil, ahead);
 release_fw:
 	release_firmware(fw);
 out:
 	up_read(&pil_pm_rwsem);
+	pil->stats.total = pil_us_since(start);
 	return ret;
 }
 
@@ -389,7 +540,39 @@ static const struct file_operations msm_pil_debugfs_fops = {
 	.write	= msm_pil_debugfs_write,
 };
 
+static ssize_t msm_pil_debugfs_timing_read(struct file *filp,
+		char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	int r;
+	char buf[320];
+	struct pil_device *pil = filp->private_data;
+	struct pil_stats *st = &pil->stats;
+
+	mutex_lock(&pil->lock);
+	r = snprintf(buf, sizeof(buf),
+		"mdt: %lld us\n"
+		"init_image: %lld us\n"
+		"fetch_wait: %lld us\n"
+		"copy: %lld us\n"
+		"verify: %lld us\n"
+		"auth_and_reset: %lld us\n"
+		"total: %lld us\n"
+		"segments: %u\n"
+		"bytes: %zu\n",
+		st->mdt, st->init_image, st->fetch_wait, st->copy,
+		st->verify, st->auth_and_reset, st->total,
+		st->segments, st->bytes);
+	mutex_unlock(&pil->lock);
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static const struct file_operations msm_pil_debugfs_timing_fops = {
+	.open	= msm_pil_debugfs_open,
+	.read	= msm_pil_debugfs_timing_read,
+};
+
 static struct dentry *pil_base_dir;
+static struct dentry *pil_timing_dir;
 
 static int msm_pil_debugfs_init(void)
 {
@@ -399,6 +582,8 @@ static int msm_pil_debugfs_init(void)
 		return -ENOMEM;
 	}
 
+	pil_timing_dir = debugfs_create_dir("timing", pil_base_dir);
+
 	return 0;
 }
 
@@ -410,6 +595,10 @@ static int msm_pil_debugfs_add(struct pil_device *pil)
 	if (!debugfs_create_file(pil->desc->name, S_IRUGO | S_IWUSR,
 				pil_base_dir, pil, &msm_pil_debugfs_fops))
 		return -ENOMEM;
+
+	if (pil_timing_dir)
+		debugfs_create_file(pil->desc->name, S_IRUGO, pil_timing_dir,
+				pil, &msm_pil_debugfs_timing_fops);
 	return 0;
 }
 #else
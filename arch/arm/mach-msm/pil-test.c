@@ -0,0 +1,313 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Self test for the peripheral image loader.
+ *
+ * Two fake peripherals are registered with reset ops that only record how
+ * they were called.  "pil_test" is loaded from a dummy ELF image and the
+ * test checks the op sequence, the memory contents left behind and the
+ * error paths; "pil_test_bad" has a metadata file that is not ELF and must
+ * be rejected before init_image() runs.
+ *
+ * The images are read from the firmware search path like any other PIL
+ * image.  tools/testing/pil/mkimages.pl generates them:
+ *
+ *   mkimages.pl <paddr> /lib/firmware
+ *   insmod pil-test.ko paddr=<paddr>
+ *
+ * <paddr> must be the start of PIL_TEST_SPAN bytes of physical memory the
+ * kernel does not use, such as the carveout of a peripheral that is not
+ * running.  Results are reported in the kernel log.
+ *
+ * PIL has no way to unregister a peripheral, so the module cannot be
+ * unloaded once it has run.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/io.h>
+#include <linux/elf.h>
+#include <linux/platform_device.h>
+
+#include <mach/peripheral-loader.h>
+
+#include "peripheral-loader.h"
+
+/* Layout of the image generated by mkimages.pl, relative to paddr */
+#define PIL_TEST_SEG0		0x0000	/* 0x2000 from pil_test.b00 */
+#define PIL_TEST_SEG0_SZ	0x2000
+#define PIL_TEST_HASH		0x2000	/* hash segment, never loaded */
+#define PIL_TEST_HASH_SZ	0x0100
+#define PIL_TEST_SEG2		0x4000	/* 0x1800 from pil_test.b02 ... */
+#define PIL_TEST_SEG2_FILESZ	0x1800
+#define PIL_TEST_SEG2_SZ	0x3000	/* ... zero filled up to 0x3000 */
+#define PIL_TEST_SEG3		0x8000	/* bss only */
+#define PIL_TEST_SEG3_SZ	0x1000
+#define PIL_TEST_SPAN		0x9000
+
+#define PIL_TEST_POISON		0xaa
+#define PIL_TEST_MAX_CALLS	8
+
+static unsigned long paddr;
+module_param(paddr, ulong, S_IRUGO);
+MODULE_PARM_DESC(paddr, "Physical address of the region to load into");
+
+enum pil_test_op {
+	OP_INIT_IMAGE,
+	OP_VERIFY_BLOB,
+	OP_AUTH_AND_RESET,
+	OP_SHUTDOWN,
+};
+
+struct pil_test_call {
+	enum pil_test_op op;
+	u32 addr;
+	size_t size;
+};
+
+struct pil_test_dev {
+	struct pil_desc desc;
+	struct pil_test_call calls[PIL_TEST_MAX_CALLS];
+	unsigned ncalls;
+};
+
+static int failures;
+
+#define pil_test_check(cond, fmt, ...)					\
+do {									\
+	if (!(cond)) {							\
+		pr_err("pil_test: FAIL %s:%d: " fmt "\n", __func__,	\
+		       __LINE__, ##__VA_ARGS__);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static struct pil_test_dev *to_test_dev(struct pil_desc *desc)
+{
+	return container_of(desc, struct pil_test_dev, desc);
+}
+
+static void pil_test_record(struct pil_desc *desc, enum pil_test_op op,
+			    u32 addr, size_t size)
+{
+	struct pil_test_dev *t = to_test_dev(desc);
+
+	if (t->ncalls < PIL_TEST_MAX_CALLS) {
+		t->calls[t->ncalls].op = op;
+		t->calls[t->ncalls].addr = addr;
+		t->calls[t->ncalls].size = size;
+	}
+	t->ncalls++;
+}
+
+static int pil_test_init_image(struct pil_desc *desc, const u8 *metadata,
+			       size_t size)
+{
+	const struct elf32_hdr *ehdr = (const struct elf32_hdr *)metadata;
+
+	pil_test_record(desc, OP_INIT_IMAGE, 0, size);
+	pil_test_check(!memcmp(ehdr->e_ident, ELFMAG, SELFMAG),
+		       "init_image got no ELF header");
+	return 0;
+}
+
+static int pil_test_verify_blob(struct pil_desc *desc, u32 phy_addr,
+				size_t size)
+{
+	pil_test_record(desc, OP_VERIFY_BLOB, phy_addr, size);
+	return 0;
+}
+
+static int pil_test_auth_and_reset(struct pil_desc *desc)
+{
+	pil_test_record(desc, OP_AUTH_AND_RESET, 0, 0);
+	return 0;
+}
+
+static int pil_test_shutdown(struct pil_desc *desc)
+{
+	pil_test_record(desc, OP_SHUTDOWN, 0, 0);
+	return 0;
+}
+
+static struct pil_reset_ops pil_test_ops = {
+	.init_image = pil_test_init_image,
+	.verify_blob = pil_test_verify_blob,
+	.auth_and_reset = pil_test_auth_and_reset,
+	.shutdown = pil_test_shutdown,
+};
+
+static struct pil_test_dev pil_test_good = {
+	.desc = {
+		.name = "pil_test",
+		.ops = &pil_test_ops,
+	},
+};
+
+static struct pil_test_dev pil_test_bad = {
+	.desc = {
+		.name = "pil_test_bad",
+		.ops = &pil_test_ops,
+	},
+};
+
+/* Byte @off of segment @seg as written by mkimages.pl */
+static u8 pil_test_pattern(unsigned seg, unsigned off)
+{
+	return (seg * 0x3b + off) & 0xff;
+}
+
+static void pil_test_expect_call(struct pil_test_dev *t, unsigned i,
+				 enum pil_test_op op, u32 addr, size_t size)
+{
+	struct pil_test_call *c = &t->calls[i];
+
+	if (i >= t->ncalls || i >= PIL_TEST_MAX_CALLS) {
+		pil_test_check(0, "%s: call %u missing", t->desc.name, i);
+		return;
+	}
+	pil_test_check(c->op == op, "%s: call %u is op %d, expected %d",
+		       t->desc.name, i, c->op, op);
+	if (op == OP_VERIFY_BLOB)
+		pil_test_check(c->addr == addr && c->size == size,
+			       "%s: verify_blob(%#x, %#zx), expected %#x, %#zx",
+			       t->desc.name, c->addr, c->size, addr, size);
+}
+
+/*
+ * Check @len bytes at @off: segment @seg's pattern if @seg >= 0, otherwise
+ * all equal to @fill.
+ */
+static void pil_test_check_range(const u8 __iomem *base, unsigned off,
+				 unsigned len, int seg, u8 fill,
+				 const char *what)
+{
+	unsigned i;
+	u8 want, got;
+
+	for (i = 0; i < len; i++) {
+		got = readb(base + off + i);
+		want = seg >= 0 ? pil_test_pattern(seg, i) : fill;
+		if (got != want) {
+			pil_test_check(0, "%s: byte %#x is %#x, expected %#x",
+				       what, off + i, got, want);
+			return;
+		}
+	}
+}
+
+static void pil_test_load(void)
+{
+	struct pil_test_dev *t = &pil_test_good;
+	u8 __iomem *base;
+	void *handle;
+
+	base = ioremap(paddr, PIL_TEST_SPAN);
+	if (!base) {
+		pil_test_check(0, "cannot map %#lx", paddr);
+		return;
+	}
+	memset_io(base, PIL_TEST_POISON, PIL_TEST_SPAN);
+
+	handle = pil_get(t->desc.name);
+	pil_test_check(!IS_ERR(handle), "pil_get failed: %ld",
+		       PTR_ERR(handle));
+	if (IS_ERR(handle))
+		goto out;
+
+	/* The hash segment is skipped, the bss-only one is verified too */
+	pil_test_check(t->ncalls == 5, "%u ops called on load, expected 5",
+		       t->ncalls);
+	pil_test_expect_call(t, 0, OP_INIT_IMAGE, 0, 0);
+	pil_test_expect_call(t, 1, OP_VERIFY_BLOB, paddr + PIL_TEST_SEG0,
+			     PIL_TEST_SEG0_SZ);
+	pil_test_expect_call(t, 2, OP_VERIFY_BLOB, paddr + PIL_TEST_SEG2,
+			     PIL_TEST_SEG2_SZ);
+	pil_test_expect_call(t, 3, OP_VERIFY_BLOB, paddr + PIL_TEST_SEG3,
+			     PIL_TEST_SEG3_SZ);
+	pil_test_expect_call(t, 4, OP_AUTH_AND_RESET, 0, 0);
+
+	pil_test_check_range(base, PIL_TEST_SEG0, PIL_TEST_SEG0_SZ, 0, 0,
+			     "segment 0");
+	pil_test_check_range(base, PIL_TEST_HASH, PIL_TEST_HASH_SZ, -1,
+			     PIL_TEST_POISON, "hash segment");
+	pil_test_check_range(base, PIL_TEST_SEG2, PIL_TEST_SEG2_FILESZ, 2, 0,
+			     "segment 2");
+	pil_test_check_range(base, PIL_TEST_SEG2 + PIL_TEST_SEG2_FILESZ,
+			     PIL_TEST_SEG2_SZ - PIL_TEST_SEG2_FILESZ, -1, 0,
+			     "segment 2 zero fill");
+	pil_test_check_range(base, PIL_TEST_SEG3, PIL_TEST_SEG3_SZ, -1, 0,
+			     "segment 3");
+
+	/* A second get only takes a reference */
+	t->ncalls = 0;
+	pil_test_check(pil_get(t->desc.name) == handle, "second pil_get");
+	pil_test_check(t->ncalls == 0, "second pil_get reloaded the image");
+	pil_put(handle);
+	pil_test_check(t->ncalls == 0, "shutdown with a reference left");
+	pil_put(handle);
+	pil_test_expect_call(t, 0, OP_SHUTDOWN, 0, 0);
+out:
+	iounmap(base);
+}
+
+static void pil_test_reject(void)
+{
+	struct pil_test_dev *t = &pil_test_bad;
+	void *handle;
+
+	handle = pil_get(t->desc.name);
+	pil_test_check(PTR_ERR(handle) == -EIO, "bad metadata gave %ld",
+		       PTR_ERR(handle));
+	pil_test_check(t->ncalls == 0, "%u ops called for bad metadata",
+		       t->ncalls);
+}
+
+static int __init pil_test_init(void)
+{
+	struct platform_device *pdev;
+	int ret;
+
+	if (!paddr) {
+		pr_err("pil_test: paddr parameter is required\n");
+		return -EINVAL;
+	}
+
+	pdev = platform_device_register_simple("pil_test", -1, NULL, 0);
+	if (IS_ERR(pdev))
+		return PTR_ERR(pdev);
+
+	pil_test_good.desc.dev = &pdev->dev;
+	pil_test_bad.desc.dev = &pdev->dev;
+	ret = msm_pil_register(&pil_test_good.desc);
+	if (!ret)
+		ret = msm_pil_register(&pil_test_bad.desc);
+	if (ret)
+		pr_warning("pil_test: no debugfs entries (%d)\n", ret);
+
+	pil_test_load();
+	pil_test_reject();
+
+	if (failures)
+		pr_err("pil_test: %d check(s) failed\n", failures);
+	else
+		pr_info("pil_test: all checks passed\n");
+
+	/* The descriptors stay registered, so the load must not fail */
+	return 0;
+}
+module_init(pil_test_init);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Peripheral image loader self test");
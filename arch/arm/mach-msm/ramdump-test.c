@@ -0,0 +1,427 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Self test for the ramdump device.
+ *
+ * A "ramdump_test" device is created and dumped from two segments of a
+ * vmalloc'd region, which hold an all zero stretch, a compressible
+ * pattern and random bytes, so a compressed dump uses every chunk type.
+ * The module reads the dump back through the device node like the
+ * userspace collectors do and checks the ELF core header, the program
+ * headers and, for a compressed dump, the chunk stream, which it decodes
+ * and compares with the region.
+ *
+ * Which stream is checked follows the ramdump module parameters; run the
+ * test once for each combination of interest:
+ *
+ *   echo 1 > /sys/module/ramdump/parameters/ramdump_elf
+ *   echo 1 > /sys/module/ramdump/parameters/ramdump_compress
+ *   insmod ramdump-test.ko
+ *
+ * The device node must be created by ueventd or devtmpfs; use the "dev"
+ * parameter if it is not /dev/ramdump_test.  Results are reported in the
+ * kernel log and the module does not stay loaded.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/delay.h>
+#include <linux/elf.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
+#include <linux/uaccess.h>
+
+#include "ramdump.h"
+
+/*
+ * Two segments at made up addresses.  Each stretch spans two chunks so at
+ * least one whole chunk of each kind survives the shift by the ELF header.
+ */
+#define RD_TEST_ZERO_SZ		(2 * RAMDUMP_CHUNK_SIZE)
+#define RD_TEST_PATTERN_SZ	(2 * RAMDUMP_CHUNK_SIZE)
+#define RD_TEST_RANDOM_SZ	(2 * RAMDUMP_CHUNK_SIZE)
+#define RD_TEST_TAIL_SZ		(3 * PAGE_SIZE)	/* partial last chunk */
+#define RD_TEST_SEG0		0x90000000
+#define RD_TEST_SEG0_SZ		(RD_TEST_ZERO_SZ + RD_TEST_PATTERN_SZ)
+#define RD_TEST_SEG1		0x98000000
+#define RD_TEST_SEG1_SZ		(RD_TEST_RANDOM_SZ + RD_TEST_TAIL_SZ)
+#define RD_TEST_REGION_SZ	(RD_TEST_SEG0_SZ + RD_TEST_SEG1_SZ)
+#define RD_TEST_NSEG		2
+#define RD_TEST_ELF_SZ		(sizeof(struct elf32_hdr) + \
+				 RD_TEST_NSEG * sizeof(struct elf32_phdr))
+
+static char *dev = "/dev/ramdump_test";
+module_param(dev, charp, S_IRUGO);
+MODULE_PARM_DESC(dev, "Path of the ramdump_test device node");
+
+static int failures;
+
+#define rd_test_check(cond, fmt, ...)					\
+do {									\
+	if (!(cond)) {							\
+		pr_err("ramdump_test: FAIL %s:%d: " fmt "\n", __func__,	\
+		       __LINE__, ##__VA_ARGS__);			\
+		failures++;						\
+	}								\
+} while (0)
+
+struct rd_test {
+	void *handle;
+	u8 *region;
+	struct ramdump_segment segs[RD_TEST_NSEG];
+	struct completion dumped;
+	int dump_ret;
+
+	struct file *filp;
+	loff_t pos;
+	size_t stream_len;
+	int eof;
+
+	/* the uncompressed dump as read back, ELF header included */
+	u8 *image;
+	size_t image_len;
+	u8 *payload;
+	unsigned int nchunks[3];	/* ZERO, RAW, LZO */
+};
+
+static int rd_test_dump(void *data)
+{
+	struct rd_test *t = data;
+
+	t->dump_ret = do_elf_ramdump(t->handle, t->segs, RD_TEST_NSEG);
+	complete(&t->dumped);
+	return 0;
+}
+
+/* read @len bytes of the stream, fewer if it ends first */
+static ssize_t rd_test_read(struct rd_test *t, void *buf, size_t len)
+{
+	mm_segment_t old_fs = get_fs();
+	size_t done = 0;
+	ssize_t n = 0;
+
+	set_fs(KERNEL_DS);
+	while (done < len) {
+		n = vfs_read(t->filp, (char __user *)buf + done, len - done,
+			     &t->pos);
+		/* the device rewinds *pos and stops serving after EOF */
+		if (n == 0)
+			t->eof = 1;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	set_fs(old_fs);
+
+	t->stream_len += done;
+
+	if (n < 0)
+		return n;
+	return done;
+}
+
+static int rd_test_wait_ready(struct rd_test *t)
+{
+	int i;
+
+	for (i = 0; i < 500; i++) {
+		if (t->filp->f_op->poll(t->filp, NULL) & POLLIN)
+			return 0;
+		msleep(10);
+	}
+	return -ETIMEDOUT;
+}
+
+static void rd_test_fill(struct rd_test *t)
+{
+	u8 *p = t->region;
+	u32 *w;
+	int i;
+
+	memset(p, 0, RD_TEST_ZERO_SZ);
+	p += RD_TEST_ZERO_SZ;
+
+	w = (u32 *)p;
+	for (i = 0; i < RD_TEST_PATTERN_SZ / sizeof(*w); i++)
+		w[i] = 0xdead0000 | (i / 64);
+	p += RD_TEST_PATTERN_SZ;
+
+	get_random_bytes(p, RD_TEST_RANDOM_SZ);
+	p += RD_TEST_RANDOM_SZ;
+
+	w = (u32 *)p;
+	for (i = 0; i < RD_TEST_TAIL_SZ / sizeof(*w); i++)
+		w[i] = i;
+
+	t->segs[0].address = RD_TEST_SEG0;
+	t->segs[0].size = RD_TEST_SEG0_SZ;
+	t->segs[0].v_address = t->region;
+	t->segs[1].address = RD_TEST_SEG1;
+	t->segs[1].size = RD_TEST_SEG1_SZ;
+	t->segs[1].v_address = t->region + RD_TEST_SEG0_SZ;
+}
+
+/* decode the chunk stream into t->image */
+static void rd_test_read_chunks(struct rd_test *t)
+{
+	struct ramdump_chunk_hdr hdr;
+	size_t max = RD_TEST_ELF_SZ + RD_TEST_REGION_SZ;
+	size_t dlen;
+	ssize_t n;
+	int ret;
+
+	t->image_len = 0;
+	for (;;) {
+		n = rd_test_read(t, &hdr, sizeof(hdr));
+		if (n == 0)
+			return;
+		if (n != sizeof(hdr)) {
+			rd_test_check(0, "short chunk header at %zu: %zd",
+				      t->image_len, n);
+			return;
+		}
+		rd_test_check(hdr.magic == RAMDUMP_CHUNK_MAGIC,
+			      "chunk at %zu has magic %#x", t->image_len,
+			      hdr.magic);
+		rd_test_check(hdr.offset == t->image_len,
+			      "chunk at %zu claims offset %llu", t->image_len,
+			      hdr.offset);
+		if (hdr.raw_len == 0 || hdr.raw_len > RAMDUMP_CHUNK_SIZE ||
+		    t->image_len + hdr.raw_len > max ||
+		    hdr.data_len > RAMDUMP_CHUNK_SIZE) {
+			rd_test_check(0, "chunk at %zu: raw_len %u data_len %u",
+				      t->image_len, hdr.raw_len,
+				      hdr.data_len);
+			return;
+		}
+
+		n = rd_test_read(t, t->payload, hdr.data_len);
+		if (n != hdr.data_len) {
+			rd_test_check(0, "short payload at %zu: %zd",
+				      t->image_len, n);
+			return;
+		}
+
+		switch (hdr.flags) {
+		case RAMDUMP_CHUNK_ZERO:
+			rd_test_check(hdr.data_len == 0,
+				      "zero chunk with %u bytes of payload",
+				      hdr.data_len);
+			memset(t->image + t->image_len, 0, hdr.raw_len);
+			t->nchunks[0]++;
+			break;
+		case RAMDUMP_CHUNK_RAW:
+			rd_test_check(hdr.data_len == hdr.raw_len,
+				      "raw chunk of %u bytes has %u of payload",
+				      hdr.raw_len, hdr.data_len);
+			memcpy(t->image + t->image_len, t->payload,
+			       hdr.raw_len);
+			t->nchunks[1]++;
+			break;
+		case RAMDUMP_CHUNK_LZO:
+			dlen = hdr.raw_len;
+			ret = lzo1x_decompress_safe(t->payload, hdr.data_len,
+					t->image + t->image_len, &dlen);
+			rd_test_check(ret == LZO_E_OK && dlen == hdr.raw_len,
+				      "lzo chunk at %zu: error %d, %zu bytes",
+				      t->image_len, ret, dlen);
+			t->nchunks[2]++;
+			break;
+		default:
+			rd_test_check(0, "chunk at %zu has flags %#x",
+				      t->image_len, hdr.flags);
+			return;
+		}
+		t->image_len += hdr.raw_len;
+	}
+}
+
+static void rd_test_check_elf(struct rd_test *t)
+{
+	struct elf32_hdr *ehdr = (struct elf32_hdr *)t->image;
+	struct elf32_phdr *phdr = (struct elf32_phdr *)(ehdr + 1);
+	unsigned long offset = RD_TEST_ELF_SZ;
+	int i;
+
+	rd_test_check(ehdr->e_ident[EI_CLASS] == ELFCLASS32 &&
+		      ehdr->e_ident[EI_DATA] == ELFDATA2LSB,
+		      "not a 32 bit little endian ELF");
+	rd_test_check(ehdr->e_type == ET_CORE, "e_type %u", ehdr->e_type);
+	rd_test_check(ehdr->e_phoff == sizeof(*ehdr), "e_phoff %u",
+		      ehdr->e_phoff);
+	rd_test_check(ehdr->e_phentsize == sizeof(*phdr), "e_phentsize %u",
+		      ehdr->e_phentsize);
+	rd_test_check(ehdr->e_phnum == RD_TEST_NSEG, "e_phnum %u",
+		      ehdr->e_phnum);
+
+	for (i = 0; i < RD_TEST_NSEG; i++, phdr++) {
+		rd_test_check(phdr->p_type == PT_LOAD, "phdr %d type %u", i,
+			      phdr->p_type);
+		rd_test_check(phdr->p_paddr == t->segs[i].address &&
+			      phdr->p_vaddr == t->segs[i].address,
+			      "phdr %d at %#x, expected %#lx", i,
+			      phdr->p_paddr, t->segs[i].address);
+		rd_test_check(phdr->p_filesz == t->segs[i].size &&
+			      phdr->p_memsz == t->segs[i].size,
+			      "phdr %d size %#x, expected %#lx", i,
+			      phdr->p_filesz, t->segs[i].size);
+		rd_test_check(phdr->p_offset == offset,
+			      "phdr %d offset %#x, expected %#lx", i,
+			      phdr->p_offset, offset);
+		offset += t->segs[i].size;
+	}
+}
+
+static void rd_test_run(struct rd_test *t)
+{
+	size_t max = RD_TEST_ELF_SZ + RD_TEST_REGION_SZ;
+	size_t hdr_len = 0;
+	int compressed, elf;
+	ssize_t n;
+	u32 magic;
+
+	if (rd_test_wait_ready(t)) {
+		rd_test_check(0, "dump never became readable");
+		return;
+	}
+
+	n = rd_test_read(t, &magic, sizeof(magic));
+	if (n != sizeof(magic)) {
+		rd_test_check(0, "short read at start of dump: %zd", n);
+		return;
+	}
+
+	compressed = magic == RAMDUMP_CHUNK_MAGIC;
+	if (compressed) {
+		t->pos = 0;
+		t->stream_len = 0;
+		rd_test_read_chunks(t);
+		rd_test_check(t->nchunks[0] && t->nchunks[1] && t->nchunks[2],
+			      "chunk types used: %u zero, %u raw, %u lzo",
+			      t->nchunks[0], t->nchunks[1], t->nchunks[2]);
+	} else {
+		memcpy(t->image, &magic, sizeof(magic));
+		n = rd_test_read(t, t->image + sizeof(magic),
+				 max - sizeof(magic));
+		if (n < 0) {
+			rd_test_check(0, "read failed: %zd", n);
+			return;
+		}
+		t->image_len = sizeof(magic) + n;
+		/* the stream must end where the dump does */
+		if (!t->eof)
+			rd_test_check(rd_test_read(t, &magic, 1) == 0,
+				      "data past the end of the dump");
+	}
+
+	elf = t->image_len >= SELFMAG &&
+		!memcmp(t->image, ELFMAG, SELFMAG);
+	if (elf) {
+		hdr_len = RD_TEST_ELF_SZ;
+		rd_test_check_elf(t);
+	}
+
+	rd_test_check(t->image_len == hdr_len + RD_TEST_REGION_SZ,
+		      "dump is %zu bytes, expected %zu", t->image_len,
+		      hdr_len + RD_TEST_REGION_SZ);
+	if (t->image_len == hdr_len + RD_TEST_REGION_SZ)
+		rd_test_check(!memcmp(t->image + hdr_len, t->region,
+				      RD_TEST_REGION_SZ),
+			      "dump contents differ from memory");
+
+	pr_info("ramdump_test: %s%s dump, %zu bytes read for %zu\n",
+		elf ? "ELF " : "", compressed ? "compressed" : "plain",
+		t->stream_len, t->image_len);
+}
+
+static int __init ramdump_test_init(void)
+{
+	struct task_struct *task;
+	struct rd_test *t;
+	int i, ret = 0;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	init_completion(&t->dumped);
+
+	t->region = vmalloc(RD_TEST_REGION_SZ);
+	t->image = vmalloc(RD_TEST_ELF_SZ + RD_TEST_REGION_SZ);
+	t->payload = vmalloc(RAMDUMP_CHUNK_SIZE);
+	if (!t->region || !t->image || !t->payload) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	rd_test_fill(t);
+
+	t->handle = create_ramdump_device("test");
+	if (!t->handle) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	/* give ueventd a moment to create the node */
+	for (i = 0; i < 100; i++) {
+		t->filp = filp_open(dev, O_RDONLY, 0);
+		if (!IS_ERR(t->filp))
+			break;
+		msleep(10);
+	}
+	if (IS_ERR(t->filp)) {
+		pr_err("ramdump_test: cannot open %s: %ld\n", dev,
+		       PTR_ERR(t->filp));
+		ret = PTR_ERR(t->filp);
+		goto out_destroy;
+	}
+
+	task = kthread_run(rd_test_dump, t, "ramdump_test");
+	if (IS_ERR(task)) {
+		filp_close(t->filp, NULL);
+		ret = PTR_ERR(task);
+		goto out_destroy;
+	}
+
+	rd_test_run(t);
+
+	/* closing the device ends the dump even if the test bailed out */
+	filp_close(t->filp, NULL);
+	wait_for_completion(&t->dumped);
+	rd_test_check(t->dump_ret == 0, "do_elf_ramdump returned %d",
+		      t->dump_ret);
+
+	if (failures)
+		pr_err("ramdump_test: %d check(s) failed\n", failures);
+	else
+		pr_info("ramdump_test: all checks passed\n");
+
+	/* Nothing to keep loaded, the results are in the log */
+	ret = -EAGAIN;
+out_destroy:
+	destroy_ramdump_device(t->handle);
+out:
+	vfree(t->payload);
+	vfree(t->image);
+	vfree(t->region);
+	kfree(t);
+	return ret;
+}
+module_init(ramdump_test_init);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Ramdump device self test");
@@ -25,6 +25,9 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/uaccess.h>
+#include <linux/elf.h>
+#include <linux/vmalloc.h>
+#include <linux/crypto.h>
 
 #include <asm-generic/poll.h>
 
@@ -32,6 +35,21 @@
 
 #define RAMDUMP_WAIT_MSECS	120000
 
+/* worst case LZO expansion of a chunk, plus the chunk header */
+#define RAMDUMP_OUT_SIZE	(sizeof(struct ramdump_chunk_hdr) + \
+				 RAMDUMP_CHUNK_SIZE + \
+				 RAMDUMP_CHUNK_SIZE / 16 + 64 + 3)
+
+static int ramdump_compress;
+module_param(ramdump_compress, int, S_IRUGO | S_IWUSR);
+
+/*
+ * do_elf_ramdump() only prepends the ELF core header when this is set, so
+ * collectors written for the bare memory image keep working by default.
+ */
+static int ramdump_elf;
+module_param(ramdump_elf, int, S_IRUGO | S_IWUSR);
+
 struct ramdump_device {
 	char name[256];
 
@@ -45,6 +63,23 @@ struct ramdump_device {
 	wait_queue_head_t dump_wait_q;
 	int nsegments;
 	struct ramdump_segment *segments;
+
+	/* ELF header and program headers prepended to the dump, if any */
+	void *elfcore_buf;
+	size_t elfcore_size;
+
+	/*
+	 * Compressed stream state: out_buf holds out_len bytes of the stream
+	 * starting at stream offset out_start, generated from the dump up to
+	 * raw_pos.  Only allocated for the duration of a dump.
+	 */
+	int compress;
+	struct crypto_comp *tfm;
+	void *raw_buf;
+	void *out_buf;
+	loff_t raw_pos;
+	loff_t out_start;
+	size_t out_len;
 };
 
 static int ramdump_open(struct inode *inode, struct file *filep)
@@ -67,7 +102,8 @@ static int ramdump_release(struct inode *inode, struct file *filep)
 }
 
 static unsigned long offset_translate(loff_t user_offset,
-		struct ramdump_device *rd_dev, unsigned long *data_left)
+		struct ramdump_device *rd_dev, unsigned long *data_left,
+		void **vaddr)
 {
 	int i = 0;
 
@@ -81,10 +117,13 @@ static unsigned long offset_translate(loff_t user_offset,
 		pr_debug("Ramdump(%s): offset_translate returning zero\n",
 				rd_dev->name);
 		*data_left = 0;
+		*vaddr = NULL;
 		return 0;
 	}
 
 	*data_left = rd_dev->segments[i].size - user_offset;
+	*vaddr = rd_dev->segments[i].v_address ?
+		rd_dev->segments[i].v_address + user_offset : NULL;
 
 	pr_debug("Ramdump(%s): Returning address: %llx, data_left = %ld\n",
 		rd_dev->name, rd_dev->segments[i].address + user_offset,
@@ -95,12 +134,153 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
+/* copy @count bytes of the uncompressed dump at @pos into @dst */
+static ssize_t ramdump_copy_raw(struct ramdump_device *rd_dev, loff_t pos,
+				void *dst, size_t count)
+{
+	size_t copied = 0;
+	unsigned long data_left, addr;
+	void *device_mem, *vaddr;
+	size_t n;
+
+	while (copied < count) {
+		if (pos < rd_dev->elfcore_size) {
+			n = min_t(size_t, count - copied,
+				  rd_dev->elfcore_size - pos);
+			memcpy(dst + copied, rd_dev->elfcore_buf + pos, n);
+		} else {
+			addr = offset_translate(pos - rd_dev->elfcore_size,
+						rd_dev, &data_left, &vaddr);
+			if (data_left == 0)
+				break;
+			n = min_t(size_t, count - copied, data_left);
+			if (vaddr) {
+				memcpy(dst + copied, vaddr, n);
+				goto next;
+			}
+			n = min_t(size_t, n, MAX_IOREMAP_SIZE);
+			device_mem = ioremap_nocache(addr, n);
+			if (device_mem == NULL) {
+				pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %zx\n",
+					rd_dev->name, addr, n);
+				return -ENOMEM;
+			}
+			memcpy(dst + copied, device_mem, n);
+			iounmap(device_mem);
+		}
+next:
+		pos += n;
+		copied += n;
+	}
+
+	return copied;
+}
+
+static int ramdump_is_zero(const void *buf, size_t len)
+{
+	const unsigned long *p = buf;
+	size_t i;
+
+	for (i = 0; i < len / sizeof(*p); i++)
+		if (p[i])
+			return 0;
+	for (i *= sizeof(*p); i < len; i++)
+		if (((const u8 *)buf)[i])
+			return 0;
+	return 1;
+}
+
+/* fill out_buf with the next chunk of the compressed stream */
+static ssize_t ramdump_next_chunk(struct ramdump_device *rd_dev)
+{
+	struct ramdump_chunk_hdr *hdr = rd_dev->out_buf;
+	void *payload = rd_dev->out_buf + sizeof(*hdr);
+	unsigned int dlen;
+	ssize_t n;
+
+	n = ramdump_copy_raw(rd_dev, rd_dev->raw_pos, rd_dev->raw_buf,
+			     RAMDUMP_CHUNK_SIZE);
+	if (n <= 0)
+		return n;
+
+	hdr->magic = RAMDUMP_CHUNK_MAGIC;
+	hdr->offset = rd_dev->raw_pos;
+	hdr->raw_len = n;
+
+	if (ramdump_is_zero(rd_dev->raw_buf, n)) {
+		hdr->flags = RAMDUMP_CHUNK_ZERO;
+		hdr->data_len = 0;
+	} else {
+		dlen = RAMDUMP_OUT_SIZE - sizeof(*hdr);
+		if (!crypto_comp_compress(rd_dev->tfm, rd_dev->raw_buf, n,
+					  payload, &dlen) && dlen < n) {
+			hdr->flags = RAMDUMP_CHUNK_LZO;
+			hdr->data_len = dlen;
+		} else {
+			hdr->flags = RAMDUMP_CHUNK_RAW;
+			hdr->data_len = n;
+			memcpy(payload, rd_dev->raw_buf, n);
+		}
+	}
+
+	rd_dev->raw_pos += n;
+	rd_dev->out_len = sizeof(*hdr) + hdr->data_len;
+	return n;
+}
+
+static ssize_t ramdump_read_compressed(struct ramdump_device *rd_dev,
+			char __user *buf, size_t count, loff_t *pos)
+{
+	size_t copy_size, off;
+	ssize_t ret;
+
+	/*
+	 * Chunk sizes are only known once a chunk has been generated, so a
+	 * read behind the current chunk regenerates the stream from the start.
+	 */
+	if (*pos < rd_dev->out_start) {
+		rd_dev->raw_pos = 0;
+		rd_dev->out_start = 0;
+		rd_dev->out_len = 0;
+	}
+
+	while (*pos >= rd_dev->out_start + rd_dev->out_len) {
+		rd_dev->out_start += rd_dev->out_len;
+		rd_dev->out_len = 0;
+		ret = ramdump_next_chunk(rd_dev);
+		if (ret <= 0) {
+			rd_dev->ramdump_status = ret ? -1 : 0;
+			goto ramdump_done;
+		}
+	}
+
+	off = *pos - rd_dev->out_start;
+	copy_size = min(count, rd_dev->out_len - off);
+	if (copy_to_user(buf, rd_dev->out_buf + off, copy_size)) {
+		pr_err("Ramdump(%s): Couldn't copy all data to user.",
+			rd_dev->name);
+		rd_dev->ramdump_status = -1;
+		ret = -EFAULT;
+		goto ramdump_done;
+	}
+
+	*pos += copy_size;
+	return copy_size;
+
+ramdump_done:
+	rd_dev->data_ready = 0;
+	*pos = 0;
+	complete(&rd_dev->ramdump_complete);
+	return ret;
+}
+
 static int ramdump_read(struct file *filep, char __user *buf, size_t count,
 			loff_t *pos)
 {
 	struct ramdump_device *rd_dev = container_of(filep->private_data,
 				struct ramdump_device, device);
 	void *device_mem = NULL;
+	void *vaddr = NULL;
 	unsigned long data_left = 0;
 	unsigned long addr = 0;
 	size_t copy_size = 0;
@@ -112,7 +292,24 @@ static int ramdump_read(struct file *filep, char __user *buf, size_t count,
 		return -EPIPE;
 	}
 
-	addr = offset_translate(*pos, rd_dev, &data_left);
+	if (rd_dev->compress)
+		return ramdump_read_compressed(rd_dev, buf, count, pos);
+
+	if (*pos < rd_dev->elfcore_size) {
+		copy_size = min_t(size_t, count, rd_dev->elfcore_size - *pos);
+		if (copy_to_user(buf, rd_dev->elfcore_buf + *pos, copy_size)) {
+			pr_err("Ramdump(%s): Couldn't copy all data to user.",
+				rd_dev->name);
+			rd_dev->ramdump_status = -1;
+			ret = -EFAULT;
+			goto ramdump_done;
+		}
+		*pos += copy_size;
+		return copy_size;
+	}
+
+	addr = offset_translate(*pos - rd_dev->elfcore_size, rd_dev,
+				&data_left, &vaddr);
 
 	/* EOF check */
 	if (data_left == 0) {
@@ -125,7 +322,7 @@ static int ramdump_read(struct file *filep, char __user *buf, size_t count,
 
 	copy_size = min(count, (size_t)MAX_IOREMAP_SIZE);
 	copy_size = min((unsigned long)copy_size, data_left);
-	device_mem = ioremap_nocache(addr, copy_size);
+	device_mem = vaddr ? vaddr : ioremap_nocache(addr, copy_size);
 
 	if (device_mem == NULL) {
 		pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %x\n",
@@ -138,13 +335,15 @@ static int ramdump_read(struct file *filep, char __user *buf, size_t count,
 	if (copy_to_user(buf, device_mem, copy_size)) {
 		pr_err("Ramdump(%s): Couldn't copy all data to user.",
 			rd_dev->name);
-		iounmap(device_mem);
+		if (!vaddr)
+			iounmap(device_mem);
 		rd_dev->ramdump_status = -1;
 		ret = -EFAULT;
 		goto ramdump_done;
 	}
 
-	iounmap(device_mem);
+	if (!vaddr)
+		iounmap(device_mem);
 	*pos += copy_size;
 
 	pr_debug("Ramdump(%s): Read %d bytes from address %lx.",
@@ -220,8 +419,66 @@ void *create_ramdump_device(const char *dev_name)
 
 	return (void *)rd_dev;
 }
+EXPORT_SYMBOL(create_ramdump_device);
 
-int do_ramdump(void *handle, struct ramdump_segment *segments,
+void destroy_ramdump_device(void *dev)
+{
+	struct ramdump_device *rd_dev = dev;
+
+	if (IS_ERR_OR_NULL(rd_dev))
+		return;
+
+	misc_deregister(&rd_dev->device);
+	kfree(rd_dev);
+}
+EXPORT_SYMBOL(destroy_ramdump_device);
+
+static void ramdump_free_compress(struct ramdump_device *rd_dev)
+{
+	rd_dev->compress = 0;
+	if (rd_dev->tfm)
+		crypto_free_comp(rd_dev->tfm);
+	rd_dev->tfm = NULL;
+	vfree(rd_dev->raw_buf);
+	rd_dev->raw_buf = NULL;
+	vfree(rd_dev->out_buf);
+	rd_dev->out_buf = NULL;
+}
+
+/* Falls back to the plain stream if compression cannot be set up */
+static void ramdump_setup_compress(struct ramdump_device *rd_dev)
+{
+	struct crypto_comp *tfm;
+
+	rd_dev->raw_pos = 0;
+	rd_dev->out_start = 0;
+	rd_dev->out_len = 0;
+	rd_dev->compress = 0;
+
+	if (!ramdump_compress)
+		return;
+
+	tfm = crypto_alloc_comp("lzo", 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_warning("Ramdump(%s): lzo unavailable, dumping uncompressed\n",
+			   rd_dev->name);
+		return;
+	}
+	rd_dev->tfm = tfm;
+
+	rd_dev->raw_buf = vmalloc(RAMDUMP_CHUNK_SIZE);
+	rd_dev->out_buf = vmalloc(RAMDUMP_OUT_SIZE);
+	if (!rd_dev->raw_buf || !rd_dev->out_buf) {
+		pr_warning("Ramdump(%s): no memory for compression, dumping uncompressed\n",
+			   rd_dev->name);
+		ramdump_free_compress(rd_dev);
+		return;
+	}
+
+	rd_dev->compress = 1;
+}
+
+static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		int nsegments)
 {
 	int ret, i;
@@ -237,6 +494,7 @@ int do_ramdump(void *handle, struct ramdump_segment *segments,
 
 	rd_dev->segments = segments;
 	rd_dev->nsegments = nsegments;
+	ramdump_setup_compress(rd_dev);
 
 	rd_dev->data_ready = 1;
 	rd_dev->ramdump_status = -1;
@@ -258,5 +516,76 @@ int do_ramdump(void *handle, struct ramdump_segment *segments,
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 
 	rd_dev->data_ready = 0;
+	ramdump_free_compress(rd_dev);
+	return ret;
+}
+
+int do_ramdump(void *handle, struct ramdump_segment *segments,
+		int nsegments)
+{
+	struct ramdump_device *rd_dev = (struct ramdump_device *)handle;
+
+	rd_dev->elfcore_buf = NULL;
+	rd_dev->elfcore_size = 0;
+	return _do_ramdump(handle, segments, nsegments);
+}
+EXPORT_SYMBOL(do_ramdump);
+
+int do_elf_ramdump(void *handle, struct ramdump_segment *segments,
+		int nsegments)
+{
+	struct ramdump_device *rd_dev = (struct ramdump_device *)handle;
+	struct elf32_hdr *ehdr;
+	struct elf32_phdr *phdr;
+	unsigned long offset;
+	int ret, i;
+
+	if (!ramdump_elf)
+		return do_ramdump(handle, segments, nsegments);
+
+	if (!rd_dev->consumer_present) {
+		pr_err("Ramdump(%s): No consumers. Aborting..\n", rd_dev->name);
+		return -EPIPE;
+	}
+
+	/* The stream serves whole pages, so the headers must describe them */
+	for (i = 0; i < nsegments; i++)
+		segments[i].size = PAGE_ALIGN(segments[i].size);
+
+	rd_dev->elfcore_size = sizeof(*ehdr) + sizeof(*phdr) * nsegments;
+	ehdr = kzalloc(rd_dev->elfcore_size, GFP_KERNEL);
+	if (!ehdr)
+		return -ENOMEM;
+	rd_dev->elfcore_buf = ehdr;
+
+	memcpy(ehdr->e_ident, ELFMAG, SELFMAG);
+	ehdr->e_ident[EI_CLASS] = ELFCLASS32;
+	ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+	ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr->e_ident[EI_OSABI] = ELFOSABI_NONE;
+	ehdr->e_type = ET_CORE;
+	ehdr->e_version = EV_CURRENT;
+	ehdr->e_phoff = sizeof(*ehdr);
+	ehdr->e_ehsize = sizeof(*ehdr);
+	ehdr->e_phentsize = sizeof(*phdr);
+	ehdr->e_phnum = nsegments;
+
+	offset = rd_dev->elfcore_size;
+	phdr = (struct elf32_phdr *)(ehdr + 1);
+	for (i = 0; i < nsegments; i++, phdr++) {
+		phdr->p_type = PT_LOAD;
+		phdr->p_offset = offset;
+		phdr->p_vaddr = phdr->p_paddr = segments[i].address;
+		phdr->p_filesz = phdr->p_memsz = segments[i].size;
+		phdr->p_flags = PF_R | PF_W | PF_X;
+		offset += phdr->p_filesz;
+	}
+
+	ret = _do_ramdump(handle, segments, nsegments);
+
+	kfree(rd_dev->elfcore_buf);
+	rd_dev->elfcore_buf = NULL;
+	rd_dev->elfcore_size = 0;
 	return ret;
 }
+EXPORT_SYMBOL(do_elf_ramdump);
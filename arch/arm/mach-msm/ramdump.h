@@ -13,13 +13,48 @@
 #ifndef _RAMDUMP_HEADER
 #define _RAMDUMP_HEADER
 
+#include <linux/types.h>
+#include <asm/sizes.h>
+
+/*
+ * Compressed dump stream
+ *
+ * When compression is enabled the device returns a sequence of chunks
+ * instead of the raw dump.  Each chunk starts with a struct
+ * ramdump_chunk_hdr describing RAMDUMP_CHUNK_SIZE (or fewer, for the last
+ * chunk) bytes of the uncompressed dump at @offset, followed by @data_len
+ * bytes of payload.  Chunks that are entirely zero carry no payload.
+ * The format is described in Documentation/arm/msm/ramdump.txt.
+ */
+#define RAMDUMP_CHUNK_MAGIC	0x504d4452	/* "RDMP" */
+#define RAMDUMP_CHUNK_SIZE	SZ_128K
+#define RAMDUMP_CHUNK_ZERO	0x1		/* no payload, all zero */
+#define RAMDUMP_CHUNK_RAW	0x2		/* payload is uncompressed */
+#define RAMDUMP_CHUNK_LZO	0x4		/* payload is LZO compressed */
+
+struct ramdump_chunk_hdr {
+	u32 magic;
+	u32 flags;
+	u64 offset;
+	u32 raw_len;
+	u32 data_len;
+};
+
 struct ramdump_segment {
 	unsigned long address;
 	unsigned long size;
+	void *v_address;	/* if set, read from here instead of ioremap */
 };
 
 void *create_ramdump_device(const char *dev_name);
+void destroy_ramdump_device(void *dev);
 int do_ramdump(void *handle, struct ramdump_segment *segments,
 		int nsegments);
+/* Same as do_ramdump() but prepends an ELF core header describing the
+ * segments, so the dump can be loaded directly by ELF aware tools.  The
+ * header is only added when the ramdump.ramdump_elf parameter is set.
+ */
+int do_elf_ramdump(void *handle, struct ramdump_segment *segments,
+		int nsegments);
 
 #endif
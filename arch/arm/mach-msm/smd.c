@@ -669,6 +669,9 @@ struct smd_channel {
 
 	int pending_pkt_sz;
 
+	/* data committed to the fifo but not yet signalled to the remote */
+	unsigned notify_pending;
+
 	char is_pkt_ch;
 
 	/*
@@ -1448,7 +1451,8 @@ static int smd_is_packet(struct smd_alloc_elm *alloc_elm)
 		return 0;
 }
 
-static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
+/* copy data into the fifo without signalling the remote processor */
+static int ch_stream_write(smd_channel_t *ch, const void *_data, int len,
 				int user_buf)
 {
 	void *ptr;
@@ -1457,12 +1461,6 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 	int orig_len = len;
 	int r = 0;
 
-	SMD_DBG("smd_stream_write() %d -> ch%d\n", len, ch->n);
-	if (len < 0)
-		return -EINVAL;
-	else if (len == 0)
-		return 0;
-
 	while ((xfer = ch_write_buffer(ch, &ptr)) != 0) {
 		if (!ch_is_open(ch)) {
 			len = orig_len;
@@ -1489,16 +1487,43 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 	}
 
 	if (orig_len - len)
-		ch->notify_other_cpu();
+		ch->notify_pending = 1;
 
 	return orig_len - len;
 }
 
+/* signal the remote processor if committed data has not been signalled */
+static void ch_write_kick(smd_channel_t *ch)
+{
+	if (ch->notify_pending) {
+		ch->notify_pending = 0;
+		ch->notify_other_cpu();
+	}
+}
+
+static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
+				int user_buf)
+{
+	int r;
+
+	SMD_DBG("smd_stream_write() %d -> ch%d\n", len, ch->n);
+	if (len < 0)
+		return -EINVAL;
+	else if (len == 0)
+		return 0;
+
+	r = ch_stream_write(ch, _data, len, user_buf);
+	ch_write_kick(ch);
+
+	return r;
+}
+
 static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 				int user_buf)
 {
 	int ret;
 	unsigned hdr[5];
+	unsigned notify_pending;
 
 	SMD_DBG("smd_packet_write() %d -> ch%d\n", len, ch->n);
 	if (len < 0)
@@ -1513,15 +1538,20 @@ static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 	hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
 
 
-	ret = smd_stream_write(ch, hdr, sizeof(hdr), 0);
+	/* header and payload go out under a single remote interrupt */
+	notify_pending = ch->notify_pending;
+	ret = ch_stream_write(ch, hdr, sizeof(hdr), 0);
 	if (ret < 0 || ret != sizeof(hdr)) {
 		SMD_DBG("%s failed to write pkt header: "
 			"%d returned\n", __func__, ret);
+		/* no packet was committed, don't signal a partial header */
+		ch->notify_pending = notify_pending;
 		return -1;
 	}
 
 
-	ret = smd_stream_write(ch, _data, len, user_buf);
+	ret = ch_stream_write(ch, _data, len, user_buf);
+	ch_write_kick(ch);
 	if (ret < 0 || ret != len) {
 		SMD_DBG("%s failed to write pkt data: "
 			"%d returned\n", __func__, ret);
@@ -2007,7 +2037,8 @@ int smd_write_start(smd_channel_t *ch, int len)
 	hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
 
 
-	ret = smd_stream_write(ch, hdr, sizeof(hdr), 0);
+	/* the remote is signalled once the first segment is written */
+	ret = ch_stream_write(ch, hdr, sizeof(hdr), 0);
 	if (ret < 0 || ret != sizeof(hdr)) {
 		ch->pending_pkt_sz = 0;
 		pr_err("%s: packet header failed to write\n", __func__);
@@ -2060,6 +2091,7 @@ int smd_write_end(smd_channel_t *ch)
 		return -E2BIG;
 	}
 
+	ch_write_kick(ch);
 	return 0;
 }
 EXPORT_SYMBOL(smd_write_end);
@@ -2306,6 +2338,175 @@ int smd_is_pkt_avail(smd_channel_t *ch)
 }
 EXPORT_SYMBOL(smd_is_pkt_avail);
 
+int smd_write_reserve(smd_channel_t *ch, void **data)
+{
+	int avail;
+
+	if (!ch || !data) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (ch->is_pkt_ch && !ch->pending_pkt_sz) {
+		pr_err("%s: no transaction in progress\n", __func__);
+		return -ENOEXEC;
+	}
+	if (!ch_is_open(ch))
+		return 0;
+
+	avail = ch_write_buffer(ch, data);
+	if (ch->is_pkt_ch && avail > ch->pending_pkt_sz)
+		avail = ch->pending_pkt_sz;
+
+	return avail;
+}
+EXPORT_SYMBOL(smd_write_reserve);
+
+int smd_write_commit(smd_channel_t *ch, int len)
+{
+	void *ptr;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (len < 0 || len > ch_write_buffer(ch, &ptr)) {
+		pr_err("%s: invalid length: %d\n", __func__, len);
+		return -EINVAL;
+	}
+	if (ch->is_pkt_ch) {
+		if (len > ch->pending_pkt_sz) {
+			pr_err("%s: segment of size: %d will make packet go "
+				"over length\n", __func__, len);
+			return -EINVAL;
+		}
+		ch->pending_pkt_sz -= len;
+	}
+	if (len == 0)
+		return 0;
+
+	ch_write_done(ch, len);
+	ch->notify_pending = 1;
+
+	return len;
+}
+EXPORT_SYMBOL(smd_write_commit);
+
+void smd_write_flush(smd_channel_t *ch)
+{
+	if (ch)
+		ch_write_kick(ch);
+}
+EXPORT_SYMBOL(smd_write_flush);
+
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int nvec)
+{
+	unsigned hdr[5];
+	int total = 0;
+	int written = 0;
+	int i;
+	int r;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (ch->pending_pkt_sz)
+		return -EBUSY;
+	if (nvec < 0 || (nvec && !vec))
+		return -EINVAL;
+
+	for (i = 0; i < nvec; i++) {
+		if ((int)vec[i].iov_len < 0)
+			return -EINVAL;
+		total += vec[i].iov_len;
+	}
+	if (total == 0)
+		return 0;
+
+	if (ch->is_pkt_ch) {
+		if (smd_stream_write_avail(ch) < (total + SMD_HEADER_SIZE))
+			return -ENOMEM;
+
+		hdr[0] = total;
+		hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
+		r = ch_stream_write(ch, hdr, sizeof(hdr), 0);
+		if (r != sizeof(hdr)) {
+			SMD_DBG("%s failed to write pkt header: "
+				"%d returned\n", __func__, r);
+			return -EPERM;
+		}
+	}
+
+	for (i = 0; i < nvec; i++) {
+		if (!vec[i].iov_len)
+			continue;
+		r = ch_stream_write(ch, vec[i].iov_base, vec[i].iov_len, 0);
+		written += r;
+		if (r != vec[i].iov_len)
+			break;
+	}
+	ch_write_kick(ch);
+
+	return written;
+}
+EXPORT_SYMBOL(smd_writev);
+
+int smd_read_peek(smd_channel_t *ch, void **data)
+{
+	unsigned long flags;
+	int avail;
+
+	if (!ch || !data) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	if (ch->is_pkt_ch && !ch->current_packet) {
+		spin_lock_irqsave(&smd_lock, flags);
+		update_packet_state(ch);
+		spin_unlock_irqrestore(&smd_lock, flags);
+	}
+
+	avail = ch_read_buffer(ch, data);
+	if (ch->is_pkt_ch && avail > ch->current_packet)
+		avail = ch->current_packet;
+
+	return avail;
+}
+EXPORT_SYMBOL(smd_read_peek);
+
+int smd_read_consume(smd_channel_t *ch, int len)
+{
+	unsigned long flags;
+	void *ptr;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (len < 0 || len > ch_read_buffer(ch, &ptr) ||
+			(ch->is_pkt_ch && len > ch->current_packet)) {
+		pr_err("%s: invalid length: %d\n", __func__, len);
+		return -EINVAL;
+	}
+	if (len == 0)
+		return 0;
+
+	ch_read_done(ch, len);
+	if (!read_intr_blocked(ch))
+		ch->notify_other_cpu();
+
+	if (ch->is_pkt_ch) {
+		spin_lock_irqsave(&smd_lock, flags);
+		ch->current_packet -= len;
+		update_packet_state(ch);
+		spin_unlock_irqrestore(&smd_lock, flags);
+	}
+
+	return len;
+}
+EXPORT_SYMBOL(smd_read_consume);
+
 
 /* -------------------------------------------------------------------------- */
 
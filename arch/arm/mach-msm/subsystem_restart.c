@@ -23,6 +23,7 @@
 #include <linux/io.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
+#include <linux/flight_recorder.h>
 
 #include <asm/current.h>
 
@@ -361,6 +362,8 @@ static int subsystem_restart_thread(void *data)
 	pr_debug("[%p]: Starting restart sequence for %s\n", current,
 			r_work->subsys->name);
 
+	flight_recorder_freeze(r_work->subsys->name);
+
 	_send_notification_to_order(restart_list,
 				restart_list_count,
 				SUBSYS_BEFORE_SHUTDOWN);
@@ -167,7 +167,7 @@ static int riva_ramdump(int enable, const struct subsys_data *subsys)
 {
 	pr_debug("%s: enable[%d]\n", MODULE_NAME, enable);
 	if (enable)
-		return do_ramdump(riva_ramdump_dev,
+		return do_elf_ramdump(riva_ramdump_dev,
 				riva_segments,
 				ARRAY_SIZE(riva_segments));
 	else
@@ -54,8 +54,9 @@ struct chksum_desc_ctx {
 };
 
 /*
- * Steps through buffer one byte at at time, calculates reflected
- * crc using table.
+ * The checksum itself is computed by __crc32c_le() in lib/crc32.c, which
+ * uses the slicing implementation selected by CONFIG_CRC32_SLICEBY8 and
+ * friends.
  */
 
 static int chksum_init(struct shash_desc *desc)
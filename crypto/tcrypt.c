@@ -255,8 +255,9 @@ static int test_hash_jiffies_digest(struct hash_desc *desc,
 			return ret;
 	}
 
-	printk("%6u opers/sec, %9lu bytes/sec\n",
-	       bcount / sec, ((long)bcount * blen) / sec);
+	printk("%6u opers/sec, %9lu bytes/sec, %5lu MB/sec\n",
+	       bcount / sec, ((long)bcount * blen) / sec,
+	       (((long)bcount * blen) / sec) >> 20);
 
 	return 0;
 }
@@ -287,8 +288,9 @@ static int test_hash_jiffies(struct hash_desc *desc, struct scatterlist *sg,
 			return ret;
 	}
 
-	printk("%6u opers/sec, %9lu bytes/sec\n",
-	       bcount / sec, ((long)bcount * blen) / sec);
+	printk("%6u opers/sec, %9lu bytes/sec, %5lu MB/sec\n",
+	       bcount / sec, ((long)bcount * blen) / sec,
+	       (((long)bcount * blen) / sec) >> 20);
 
 	return 0;
 }
@@ -518,8 +520,9 @@ static int test_ahash_jiffies_digest(struct ahash_request *req, int blen,
 			return ret;
 	}
 
-	printk("%6u opers/sec, %9lu bytes/sec\n",
-	       bcount / sec, ((long)bcount * blen) / sec);
+	printk("%6u opers/sec, %9lu bytes/sec, %5lu MB/sec\n",
+	       bcount / sec, ((long)bcount * blen) / sec,
+	       (((long)bcount * blen) / sec) >> 20);
 
 	return 0;
 }
@@ -550,8 +553,9 @@ static int test_ahash_jiffies(struct ahash_request *req, int blen,
 			return ret;
 	}
 
-	pr_cont("%6u opers/sec, %9lu bytes/sec\n",
-		bcount / sec, ((long)bcount * blen) / sec);
+	pr_cont("%6u opers/sec, %9lu bytes/sec, %5lu MB/sec\n",
+		bcount / sec, ((long)bcount * blen) / sec,
+		(((long)bcount * blen) / sec) >> 20);
 
 	return 0;
 }
@@ -1154,6 +1158,10 @@ static int do_test(int m)
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
 		if (mode > 300 && mode < 400) break;
 
+	case 319:
+		test_hash_speed("crc32c", sec, generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
 	case 399:
 		break;
 
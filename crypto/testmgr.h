@@ -41,7 +41,7 @@ struct hash_testvec {
 	char *plaintext;
 	char *digest;
 	unsigned char tap[MAX_TAP];
-	unsigned char psize;
+	unsigned short psize;
 	unsigned char np;
 	unsigned char ksize;
 };
@@ -9883,7 +9883,7 @@ static struct hash_testvec michael_mic_tv_template[] = {
 /*
  * CRC32C test vectors
  */
-#define CRC32C_TEST_VECTORS 14
+#define CRC32C_TEST_VECTORS 15
 
 static struct hash_testvec crc32c_tv_template[] = {
 	{
@@ -10055,6 +10055,50 @@ static struct hash_testvec crc32c_tv_template[] = {
 		.np = 2,
 		.tap = { 31, 209 }
 	},
+	{
+		.key = "\x8a\x3b\x5c\xe1",
+		.ksize = 4,
+		.plaintext = "\x07\x24\x41\x5e\x7b\x98\xb5\xd2"
+			     "\xef\x0c\x29\x46\x63\x80\x9d\xba"
+			     "\xd7\xf4\x11\x2e\x4b\x68\x85\xa2"
+			     "\xbf\xdc\xf9\x16\x33\x50\x6d\x8a"
+			     "\xa7\xc4\xe1\xfe\x1b\x38\x55\x72"
+			     "\x8f\xac\xc9\xe6\x03\x20\x3d\x5a"
+			     "\x77\x94\xb1\xce\xeb\x08\x25\x42"
+			     "\x5f\x7c\x99\xb6\xd3\xf0\x0d\x2a"
+			     "\x47\x64\x81\x9e\xbb\xd8\xf5\x12"
+			     "\x2f\x4c\x69\x86\xa3\xc0\xdd\xfa"
+			     "\x17\x34\x51\x6e\x8b\xa8\xc5\xe2"
+			     "\xff\x1c\x39\x56\x73\x90\xad\xca"
+			     "\xe7\x04\x21\x3e\x5b\x78\x95\xb2"
+			     "\xcf\xec\x09\x26\x43\x60\x7d\x9a"
+			     "\xb7\xd4\xf1\x0e\x2b\x48\x65\x82"
+			     "\x9f\xbc\xd9\xf6\x13\x30\x4d\x6a"
+			     "\x87\xa4\xc1\xde\xfb\x18\x35\x52"
+			     "\x6f\x8c\xa9\xc6\xe3\x00\x1d\x3a"
+			     "\x57\x74\x91\xae\xcb\xe8\x05\x22"
+			     "\x3f\x5c\x79\x96\xb3\xd0\xed\x0a"
+			     "\x27\x44\x61\x7e\x9b\xb8\xd5\xf2"
+			     "\x0f\x2c\x49\x66\x83\xa0\xbd\xda"
+			     "\xf7\x14\x31\x4e\x6b\x88\xa5\xc2"
+			     "\xdf\xfc\x19\x36\x53\x70\x8d\xaa"
+			     "\xc7\xe4\x01\x1e\x3b\x58\x75\x92"
+			     "\xaf\xcc\xe9\x06\x23\x40\x5d\x7a"
+			     "\x97\xb4\xd1\xee\x0b\x28\x45\x62"
+			     "\x7f\x9c\xb9\xd6\xf3\x10\x2d\x4a"
+			     "\x67\x84\xa1\xbe\xdb\xf8\x15\x32"
+			     "\x4f\x6c\x89\xa6\xc3\xe0\xfd\x1a"
+			     "\x37\x54\x71\x8e\xab\xc8\xe5\x02"
+			     "\x1f\x3c\x59\x76\x93\xb0\xcd\xea"
+			     "\x07\x24\x41\x5e\x7b\x98\xb5\xd2"
+			     "\xef\x0c\x29\x46\x63\x80\x9d\xba"
+			     "\xd7\xf4\x11\x2e\x4b\x68\x85\xa2"
+			     "\xbf\xdc\xf9\x16\x33\x50\x6d\x8a"
+			     "\xa7\xc4\xe1\xfe\x1b\x38\x55\x72"
+			     "\x8f\xac\xc9\xe6",
+		.psize = 300,
+		.digest = "\xba\x99\xd4\xd2",
+	},
 };
 
 #endif	/* _CRYPTO_TESTMGR_H */
@@ -28,6 +28,8 @@
 #include <linux/async.h>
 #include <linux/suspend.h>
 #include <linux/timer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "../base.h"
 #include "power.h"
@@ -58,6 +60,9 @@ struct dpm_drv_wd_data {
 
 static int async_error;
 
+/* Suspend/resume callbacks running longer than this (usecs) get reported */
+static u32 dpm_budget_us = 100000;
+
 /**
  * device_pm_init - Initialize the PM-related part of a device object.
  * @dev: Device object being initialized.
@@ -503,6 +508,20 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	return error;
 }
 
+static void dpm_account(struct device *dev, ktime_t starttime, bool resume)
+{
+	s64 usecs = ktime_us_delta(ktime_get(), starttime);
+
+	if (resume)
+		dev->power.resume_time_us = usecs;
+	else
+		dev->power.suspend_time_us = usecs;
+
+	if (dpm_budget_us && usecs > dpm_budget_us)
+		dev_warn(dev, "%s took %lld usecs, budget %u\n",
+			 resume ? "resume" : "suspend", usecs, dpm_budget_us);
+}
+
 /**
  * device_resume - Execute "resume" callbacks for given device.
  * @dev: Device to handle.
@@ -511,12 +530,14 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t starttime;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	starttime = ktime_get();
 	device_lock(dev);
 
 	/*
@@ -564,6 +585,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = false;
+	dpm_account(dev, starttime, true);
 
  Unlock:
 	device_unlock(dev);
@@ -874,8 +896,10 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t starttime;
 
 	dpm_wait_for_children(dev, async);
+	starttime = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -931,6 +955,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = !error;
+	dpm_account(dev, starttime, false);
 
  Unlock:
 	device_unlock(dev);
@@ -1147,3 +1172,48 @@ int device_pm_wait_for_dev(struct device *subordinate, struct device *dev)
 	return async_error;
 }
 EXPORT_SYMBOL_GPL(device_pm_wait_for_dev);
+
+static int dpm_times_show(struct seq_file *s, void *data)
+{
+	struct device *dev;
+
+	seq_printf(s, "%-32s %-24s %5s %10s %10s\n", "device", "driver",
+		   "async", "suspend_us", "resume_us");
+	mutex_lock(&dpm_list_mtx);
+	list_for_each_entry(dev, &dpm_list, power.entry)
+		seq_printf(s, "%-32s %-24s %5d %10lld %10lld\n",
+			   dev_name(dev),
+			   dev->driver ? dev->driver->name : "",
+			   dev->power.async_suspend,
+			   dev->power.suspend_time_us,
+			   dev->power.resume_time_us);
+	mutex_unlock(&dpm_list_mtx);
+	return 0;
+}
+
+static int dpm_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_times_show, NULL);
+}
+
+static const struct file_operations dpm_times_fops = {
+	.open		= dpm_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("dpm", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	debugfs_create_file("times", S_IRUGO, dir, NULL, &dpm_times_fops);
+	debugfs_create_u32("budget_us", S_IRUGO | S_IWUSR, dir,
+			   &dpm_budget_us);
+	return 0;
+}
+late_initcall(dpm_debugfs_init);
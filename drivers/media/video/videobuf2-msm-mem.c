@@ -190,8 +190,14 @@ int videobuf2_pmem_contig_user_get(struct videobuf2_contig_pmem *mem,
 		pr_err("%s ION import failed\n", __func__);
 		return PTR_ERR(mem->ion_handle);
 	}
+	/*
+	 * Keep the camera domain mapping until the buffer itself is freed,
+	 * so a buffer that is queued again after a stream restart is only
+	 * looked up in ION instead of being mapped again.
+	 */
 	rc = ion_map_iommu(client, mem->ion_handle, CAMERA_DOMAIN, GEN_POOL,
-		SZ_4K, 0, (unsigned long *)&mem->phyaddr, &len, UNCACHED, 0);
+		SZ_4K, 0, (unsigned long *)&mem->phyaddr, &len, UNCACHED,
+		ION_IOMMU_UNMAP_DELAYED);
 	if (rc < 0)
 		ion_free(client, mem->ion_handle);
 #elif CONFIG_ANDROID_PMEM
@@ -336,6 +336,9 @@ struct mdp4_overlay_pipe {
 	struct mdp_overlay req_data;
 };
 
+/* overlay play latency histogram, power of two buckets in ms */
+#define MDP4_PLAY_HIST_MAX	8
+
 struct mdp4_statistic {
 	ulong intr_tot;
 	ulong intr_dma_p;
@@ -380,8 +383,16 @@ struct mdp4_statistic {
 	ulong err_stage;
 	ulong err_play;
 	ulong err_underflow;
+	ulong play_setup_hist[MDP4_PLAY_HIST_MAX];	/* queue to kickoff */
+	ulong play_wait_hist[MDP4_PLAY_HIST_MAX];	/* kickoff to done */
+	ulong play_vsync_hist[MDP4_PLAY_HIST_MAX];	/* kickoff to vsync */
+	ulong iommu_map;
+	ulong iommu_map_us;	/* total time in ion_map_iommu */
 };
 
+/* last vsync (or dma done on command mode panels) seen per mixer */
+extern ktime_t mdp4_vsync_time[MDP4_MIXER_MAX];
+
 struct mdp4_overlay_pipe *mdp4_overlay_ndx2pipe(int ndx);
 void mdp4_sw_reset(unsigned long bits);
 void mdp4_display_intf_sel(int output, unsigned long intf);
@@ -525,6 +536,9 @@ int mdp4_overlay_unset(struct fb_info *info, int ndx);
 int mdp4_overlay_play_wait(struct fb_info *info,
 	struct msmfb_overlay_data *req);
 int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req);
+int mdp4_overlay_commit(struct fb_info *info,
+	struct msmfb_overlay_commit *req);
+void mdp4_overlay_commit_flush(struct msm_fb_data_type *mfd);
 struct mdp4_overlay_pipe *mdp4_overlay_pipe_alloc(int ptype, int mixer);
 void mdp4_overlay_pipe_free(struct mdp4_overlay_pipe *pipe);
 void mdp4_overlay_dmap_cfg(struct msm_fb_data_type *mfd, int lcdc);
@@ -36,9 +36,14 @@
 #include <linux/uaccess.h>
 #include <linux/mutex.h>
 #include <linux/msm_kgsl.h>
+#include <linux/workqueue.h>
+#ifdef CONFIG_SW_SYNC
+#include <linux/sw_sync.h>
+#endif
 #include "mdp.h"
 #include "msm_fb.h"
 #include "mdp4.h"
+#include "mdp4_trace.h"
 
 #define VERSION_KEY_MASK	0xFFFFFF00
 
@@ -107,6 +112,7 @@ int mdp4_overlay_iommu_map_buf(int mem_id,
 	struct ion_handle **srcp_ihdl)
 {
 	struct mdp4_iommu_pipe_info *iom_pipe_info;
+	ktime_t t;
 
 	if (!display_iclient)
 		return -EINVAL;
@@ -120,6 +126,12 @@ int mdp4_overlay_iommu_map_buf(int mem_id,
 		ion_share(display_iclient, *srcp_ihdl));
 	pr_debug("mixer %u, pipe %u, plane %u\n", pipe->mixer_num,
 		pipe->pipe_ndx, plane);
+	/*
+	 * With ION_IOMMU_UNMAP_DELAYED the mapping lives as long as the
+	 * buffer, so mapping a buffer that was queued before is only a
+	 * lookup in ION.
+	 */
+	t = ktime_get();
 	if (ion_map_iommu(display_iclient, *srcp_ihdl,
 		DISPLAY_DOMAIN, GEN_POOL, SZ_4K, 0, start,
 		len, 0, ION_IOMMU_UNMAP_DELAYED)) {
@@ -127,6 +139,8 @@ int mdp4_overlay_iommu_map_buf(int mem_id,
 		pr_err("ion_map_iommu() failed\n");
 		return -EINVAL;
 	}
+	mdp4_stat.iommu_map++;
+	mdp4_stat.iommu_map_us += ktime_us_delta(ktime_get(), t);
 
 	iom_pipe_info = &mdp_iommu[pipe->mixer_num][pipe->pipe_ndx - 1];
 	if (!iom_pipe_info->ihdl[plane]) {
@@ -2728,49 +2742,108 @@ int mdp4_overlay_play_wait(struct fb_info *info, struct msmfb_overlay_data *req)
 	return 0;
 }
 
-int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
+static int mdp4_play_hist_bucket(s64 us)
+{
+	int bucket = fls((u32)min_t(s64, us / USEC_PER_MSEC, INT_MAX));
+
+	return min(bucket, MDP4_PLAY_HIST_MAX - 1);
+}
+
+static void mdp4_overlay_play_account(struct mdp4_overlay_pipe *pipe,
+				      ktime_t queue, ktime_t kickoff)
+{
+	ktime_t done = ktime_get();
+	ktime_t vsync;
+	unsigned long flag;
+
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	vsync = mdp4_vsync_time[pipe->mixer_num];
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+
+	/* nothing was waited for if the last interrupt predates kickoff */
+	if (ktime_to_ns(vsync) < ktime_to_ns(kickoff))
+		vsync = ktime_set(0, 0);
+	else
+		mdp4_stat.play_vsync_hist[mdp4_play_hist_bucket(
+				ktime_us_delta(vsync, kickoff))]++;
+
+	mdp4_stat.play_setup_hist[mdp4_play_hist_bucket(
+				ktime_us_delta(kickoff, queue))]++;
+	mdp4_stat.play_wait_hist[mdp4_play_hist_bucket(
+				ktime_us_delta(done, kickoff))]++;
+	trace_mdp4_overlay_play(pipe->pipe_ndx, pipe->mixer_num, queue,
+				kickoff, vsync, done);
+}
+
+/*
+ * Buffers of one play, resolved by mdp4_overlay_play_resolve() before any
+ * pipe register is written.  The files are dropped by mdp4_overlay_play_put.
+ */
+struct mdp4_play_buf {
+	struct file *srcp0_file;
+	struct file *srcp1_file;
+	struct file *srcp2_file;
+	int ps0_need;
+	uint32_t flags;		/* plane 0 memory type */
+	uint32 srcp0_addr;
+	uint32 srcp0_ystride;
+	uint32 srcp1_addr;
+	uint32 srcp1_ystride;
+	uint32 srcp2_addr;
+	uint32 srcp2_ystride;
+};
+
+static void mdp4_overlay_play_put(struct mdp4_play_buf *b)
+{
+#ifdef CONFIG_ANDROID_PMEM
+	if (b->srcp0_file)
+		put_pmem_file(b->srcp0_file);
+	if (b->srcp1_file)
+		put_pmem_file(b->srcp1_file);
+	if (b->srcp2_file)
+		put_pmem_file(b->srcp2_file);
+#endif
+	/* only source may use frame buffer */
+	if (b->flags & MDP_MEMORY_ID_TYPE_FB)
+		fput_light(b->srcp0_file, b->ps0_need);
+}
+
+/*
+ * Look up the buffers of @req and work out the plane addresses @pipe
+ * would fetch from.  Nothing is written to @pipe or the hardware, so a
+ * failure leaves what is on screen untouched.  Called with ov_mutex held.
+ */
+static int mdp4_overlay_play_resolve(struct fb_info *info,
+				     struct mdp4_overlay_pipe *pipe,
+				     struct msmfb_overlay_data *req,
+				     struct mdp4_play_buf *b)
 {
-	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 	struct msmfb_data *img;
-	struct mdp4_overlay_pipe *pipe;
 	ulong start, addr;
 	ulong len = 0;
-	struct file *srcp0_file = NULL;
-	struct file *srcp1_file = NULL, *srcp2_file = NULL;
 	struct ion_handle *srcp0_ihdl = NULL;
 	struct ion_handle *srcp1_ihdl = NULL, *srcp2_ihdl = NULL;
-	int ps0_need, p_need;
+	int p_need;
 	uint32_t overlay_version = 0;
-	int ret = 0;
-
-	if (mfd == NULL)
-		return -ENODEV;
 
-	if (!mfd->panel_power_on) /* suspended */
-		return -EPERM;
-
-	pipe = mdp4_overlay_ndx2pipe(req->id);
-	if (pipe == NULL) {
-		mdp4_stat.err_play++;
-		return -ENODEV;
-	}
-
-	if (mutex_lock_interruptible(&mfd->dma->ov_mutex))
-		return -EINTR;
+	/* planes the format does not fetch keep their current setup */
+	b->srcp1_addr = pipe->srcp1_addr;
+	b->srcp1_ystride = pipe->srcp1_ystride;
+	b->srcp2_addr = pipe->srcp2_addr;
+	b->srcp2_ystride = pipe->srcp2_ystride;
 
 	img = &req->data;
-	get_img(img, info, pipe, 0, &start, &len, &srcp0_file,
-		&ps0_need, &srcp0_ihdl);
+	b->flags = img->flags;
+	get_img(img, info, pipe, 0, &start, &len, &b->srcp0_file,
+		&b->ps0_need, &srcp0_ihdl);
 	if (len == 0) {
-		mutex_unlock(&mfd->dma->ov_mutex);
 		pr_err("%s: pmem Error\n", __func__);
-		ret = -1;
-		goto end;
+		return -1;
 	}
 
 	addr = start + img->offset;
-	pipe->srcp0_addr = addr;
-	pipe->srcp0_ystride = pipe->src_width * pipe->bpp;
+	b->srcp0_addr = addr;
+	b->srcp0_ystride = pipe->src_width * pipe->bpp;
 
 	if ((req->version_key & VERSION_KEY_MASK) == 0xF9E8D700)
 		overlay_version = (req->version_key & ~VERSION_KEY_MASK);
@@ -2778,90 +2851,102 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 	if (pipe->fetch_plane == OVERLAY_PLANE_PSEUDO_PLANAR) {
 		if (overlay_version > 0) {
 			img = &req->plane1_data;
-			get_img(img, info, pipe, 1, &start, &len, &srcp1_file,
-				&p_need, &srcp1_ihdl);
+			get_img(img, info, pipe, 1, &start, &len,
+				&b->srcp1_file, &p_need, &srcp1_ihdl);
 			if (len == 0) {
-				mutex_unlock(&mfd->dma->ov_mutex);
 				pr_err("%s: Error to get plane1\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
-			pipe->srcp1_addr = start + img->offset;
+			b->srcp1_addr = start + img->offset;
 		} else if (pipe->frame_format ==
 				MDP4_FRAME_FORMAT_VIDEO_SUPERTILE) {
 			struct tile_desc tile;
 
 			tile_samsung(&tile);
-			pipe->srcp1_addr = addr + tile_mem_size(pipe, &tile);
+			b->srcp1_addr = addr + tile_mem_size(pipe, &tile);
 		} else {
-			pipe->srcp1_addr = addr + (pipe->src_width *
+			b->srcp1_addr = addr + (pipe->src_width *
 						pipe->src_height);
 		}
-		pipe->srcp0_ystride = pipe->src_width;
+		b->srcp0_ystride = pipe->src_width;
 		if ((pipe->src_format == MDP_Y_CRCB_H1V1) ||
 			(pipe->src_format == MDP_Y_CBCR_H1V1)) {
 			if (pipe->src_width > YUV_444_MAX_WIDTH)
-				pipe->srcp1_ystride = pipe->src_width << 2;
+				b->srcp1_ystride = pipe->src_width << 2;
 			else
-				pipe->srcp1_ystride = pipe->src_width << 1;
+				b->srcp1_ystride = pipe->src_width << 1;
 		} else
-			pipe->srcp1_ystride = pipe->src_width;
+			b->srcp1_ystride = pipe->src_width;
 
 	} else if (pipe->fetch_plane == OVERLAY_PLANE_PLANAR) {
 		if (overlay_version > 0) {
 			img = &req->plane1_data;
-			get_img(img, info, pipe, 1, &start, &len, &srcp1_file,
-				&p_need, &srcp1_ihdl);
+			get_img(img, info, pipe, 1, &start, &len,
+				&b->srcp1_file, &p_need, &srcp1_ihdl);
 			if (len == 0) {
-				mutex_unlock(&mfd->dma->ov_mutex);
 				pr_err("%s: Error to get plane1\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
-			pipe->srcp1_addr = start + img->offset;
+			b->srcp1_addr = start + img->offset;
 
 			img = &req->plane2_data;
-			get_img(img, info, pipe, 2, &start, &len, &srcp2_file,
-				&p_need, &srcp2_ihdl);
+			get_img(img, info, pipe, 2, &start, &len,
+				&b->srcp2_file, &p_need, &srcp2_ihdl);
 			if (len == 0) {
-				mutex_unlock(&mfd->dma->ov_mutex);
 				pr_err("%s: Error to get plane2\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
-			pipe->srcp2_addr = start + img->offset;
+			b->srcp2_addr = start + img->offset;
 		} else {
 			if (pipe->src_format == MDP_Y_CR_CB_GH2V2) {
 				addr += (ALIGN(pipe->src_width, 16) *
 					pipe->src_height);
-				pipe->srcp1_addr = addr;
+				b->srcp1_addr = addr;
 				addr += ((ALIGN((pipe->src_width / 2), 16)) *
 					(pipe->src_height / 2));
-				pipe->srcp2_addr = addr;
+				b->srcp2_addr = addr;
 			} else {
 				addr += (pipe->src_width * pipe->src_height);
-				pipe->srcp1_addr = addr;
+				b->srcp1_addr = addr;
 				addr += ((pipe->src_width / 2) *
 					(pipe->src_height / 2));
-				pipe->srcp2_addr = addr;
+				b->srcp2_addr = addr;
 			}
 		}
 		/* mdp planar format expects Cb in srcp1 and Cr in p2 */
 		if ((pipe->src_format == MDP_Y_CR_CB_H2V2) ||
 			(pipe->src_format == MDP_Y_CR_CB_GH2V2))
-			swap(pipe->srcp1_addr, pipe->srcp2_addr);
+			swap(b->srcp1_addr, b->srcp2_addr);
 
 		if (pipe->src_format == MDP_Y_CR_CB_GH2V2) {
-			pipe->srcp0_ystride = ALIGN(pipe->src_width, 16);
-			pipe->srcp1_ystride = ALIGN(pipe->src_width / 2, 16);
-			pipe->srcp2_ystride = ALIGN(pipe->src_width / 2, 16);
+			b->srcp0_ystride = ALIGN(pipe->src_width, 16);
+			b->srcp1_ystride = ALIGN(pipe->src_width / 2, 16);
+			b->srcp2_ystride = ALIGN(pipe->src_width / 2, 16);
 		} else {
-			pipe->srcp0_ystride = pipe->src_width;
-			pipe->srcp1_ystride = pipe->src_width / 2;
-			pipe->srcp2_ystride = pipe->src_width / 2;
+			b->srcp0_ystride = pipe->src_width;
+			b->srcp1_ystride = pipe->src_width / 2;
+			b->srcp2_ystride = pipe->src_width / 2;
 		}
 	}
 
+	return 0;
+}
+
+/*
+ * Program @pipe with the buffers resolved into @b and stage it on its
+ * mixer.  Called with ov_mutex held; the interface is not kicked off.
+ */
+static void mdp4_overlay_play_setup(struct msm_fb_data_type *mfd,
+				    struct mdp4_overlay_pipe *pipe,
+				    struct mdp4_play_buf *b)
+{
+	pipe->srcp0_addr = b->srcp0_addr;
+	pipe->srcp0_ystride = b->srcp0_ystride;
+	pipe->srcp1_addr = b->srcp1_addr;
+	pipe->srcp1_ystride = b->srcp1_ystride;
+	pipe->srcp2_addr = b->srcp2_addr;
+	pipe->srcp2_ystride = b->srcp2_ystride;
+
 	if (mfd->panel_info.pdest == MDP4_MIXER0) {
 		if (dbg_force_ov0_blt)
 			mfd->use_ov0_blt |= (0x1 << 8);
@@ -2902,7 +2987,41 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 		mdp4_overlay_reg_flush(pipe, 0);
 
 	mdp4_mixer_stage_up(pipe);
+}
+
+int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp4_overlay_pipe *pipe;
+	struct mdp4_play_buf buf = { 0 };
+	int ret = 0;
+	ktime_t queue, kickoff;
+
+	queue = ktime_get();
+
+	if (mfd == NULL)
+		return -ENODEV;
+
+	if (!mfd->panel_power_on) /* suspended */
+		return -EPERM;
+
+	pipe = mdp4_overlay_ndx2pipe(req->id);
+	if (pipe == NULL) {
+		mdp4_stat.err_play++;
+		return -ENODEV;
+	}
+
+	if (mutex_lock_interruptible(&mfd->dma->ov_mutex))
+		return -EINTR;
 
+	ret = mdp4_overlay_play_resolve(info, pipe, req, &buf);
+	if (ret) {
+		mutex_unlock(&mfd->dma->ov_mutex);
+		goto end;
+	}
+	mdp4_overlay_play_setup(mfd, pipe, &buf);
+
+	kickoff = ktime_get();
 	if (pipe->mixer_num == MDP4_MIXER2) {
 		ctrl->mixer2_played++;
 #ifdef CONFIG_FB_MSM_WRITEBACK_MSM_PANEL
@@ -2944,6 +3063,7 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 			/* mddi & mipi dsi cmd mode */
 			if (pipe->flags & MDP_OV_PLAY_NOWAIT) {
 				mdp4_stat.overlay_play[pipe->mixer_num]++;
+				mdp4_overlay_play_account(pipe, queue, kickoff);
 				mutex_unlock(&mfd->dma->ov_mutex);
 				goto end;
 			}
@@ -2968,22 +3088,290 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 	if (!(pipe->flags & MDP_OV_PLAY_NOWAIT))
 		mdp4_iommu_unmap(pipe);
 	mdp4_stat.overlay_play[pipe->mixer_num]++;
+	mdp4_overlay_play_account(pipe, queue, kickoff);
 	mutex_unlock(&mfd->dma->ov_mutex);
 end:
-#ifdef CONFIG_ANDROID_PMEM
-	if (srcp0_file)
-		put_pmem_file(srcp0_file);
-	if (srcp1_file)
-		put_pmem_file(srcp1_file);
-	if (srcp2_file)
-		put_pmem_file(srcp2_file);
+	mdp4_overlay_play_put(&buf);
+	return ret;
+}
+
+/*
+ * Asynchronous commit.  The ioctl stages every pipe of the request and
+ * kicks the interface off in the caller's context, where the buffer fds
+ * can be resolved, and leaves the vsync or dma wait, the unmap of the
+ * previous buffers and the release fence to a work item.  One commit per
+ * mixer is in flight: the next one waits for the previous to be displayed
+ * before it stages, so the pipes are never reprogrammed under a frame that
+ * has not been latched yet.
+ *
+ * Commit N hands out a fence at N + 1 on the mixer's timeline, which
+ * advances by one each time a commit is displayed, so the fence signals
+ * when commit N + 1 has replaced this one on screen.  Blanking the panel
+ * counts as a commit and releases the last buffers.
+ */
+struct mdp4_commit_ctrl {
+	struct work_struct work;
+	struct msm_fb_data_type *mfd;
+	struct mdp4_overlay_pipe *pipe[MSMFB_OVERLAY_COMMIT_MAX];
+	int npipes;
+	ktime_t queue;
+	ktime_t kickoff;
+	u32 frame;		/* commits and blanks, under ov_mutex */
+#ifdef CONFIG_SW_SYNC
+	struct sw_sync_timeline *timeline;
 #endif
-	/* only source may use frame buffer */
-	if (img->flags & MDP_MEMORY_ID_TYPE_FB)
-		fput_light(srcp0_file, ps0_need);
+};
+
+static void mdp4_overlay_commit_work(struct work_struct *work);
+
+/* primary and external interface, not writeback */
+static struct mdp4_commit_ctrl mdp4_commit_db[MDP4_MIXER2] = {
+	[MDP4_MIXER0] = {
+		.work = __WORK_INITIALIZER(mdp4_commit_db[MDP4_MIXER0].work,
+					   mdp4_overlay_commit_work),
+	},
+	[MDP4_MIXER1] = {
+		.work = __WORK_INITIALIZER(mdp4_commit_db[MDP4_MIXER1].work,
+					   mdp4_overlay_commit_work),
+	},
+};
+
+static void mdp4_overlay_commit_kickoff(struct msm_fb_data_type *mfd,
+					struct mdp4_overlay_pipe *pipe)
+{
+	if (pipe->mixer_num == MDP4_MIXER1) {
+		ctrl->mixer1_played++;
+		if (ctrl->panel_mode & MDP4_PANEL_DTV)
+			mdp4_overlay_dtv_start();
+		return;
+	}
+
+	ctrl->mixer0_played++;
+	if (ctrl->panel_mode & MDP4_PANEL_LCDC)
+		mdp4_overlay_lcdc_start();
+#ifdef CONFIG_FB_MSM_MIPI_DSI
+	else if (ctrl->panel_mode & MDP4_PANEL_DSI_VIDEO)
+		mdp4_overlay_dsi_video_start();
+	else if (ctrl->panel_mode & MDP4_PANEL_DSI_CMD) {
+		mdp4_iommu_attach();
+		mdp4_dsi_cmd_dma_busy_wait(mfd);
+		mdp4_dsi_cmd_kickoff_video(mfd, pipe);
+	}
+#else
+	else if (ctrl->panel_mode & MDP4_PANEL_MDDI) {
+		mdp4_mddi_dma_busy_wait(mfd);
+		mdp4_mddi_kickoff_video(mfd, pipe);
+	}
+#endif
+}
+
+/* wait until the frame started by mdp4_overlay_commit_kickoff() is out */
+static void mdp4_overlay_commit_wait(struct msm_fb_data_type *mfd,
+				     struct mdp4_overlay_pipe *pipe)
+{
+	if (pipe->mixer_num == MDP4_MIXER1) {
+		if (ctrl->panel_mode & MDP4_PANEL_DTV) {
+			mdp4_overlay_dtv_ov_done_push(mfd, pipe);
+			if (!mfd->use_ov1_blt)
+				mdp4_overlay1_update_blt_mode(mfd);
+		}
+		return;
+	}
+
+	if (ctrl->panel_mode & MDP4_PANEL_LCDC) {
+		mdp4_overlay_lcdc_vsync_push(mfd, pipe);
+		if (!mfd->use_ov0_blt)
+			mdp4_overlay_update_blt_mode(mfd);
+	}
+#ifdef CONFIG_FB_MSM_MIPI_DSI
+	else if (ctrl->panel_mode & MDP4_PANEL_DSI_VIDEO) {
+		mdp4_overlay_dsi_video_vsync_push(mfd, pipe);
+		if (!mfd->use_ov0_blt)
+			mdp4_overlay_update_blt_mode(mfd);
+	} else if (ctrl->panel_mode & MDP4_PANEL_DSI_CMD)
+		mdp4_dsi_cmd_dma_busy_wait(mfd);
+#else
+	else if (ctrl->panel_mode & MDP4_PANEL_MDDI)
+		mdp4_mddi_dma_busy_wait(mfd);
+#endif
+}
+
+static void mdp4_overlay_commit_work(struct work_struct *work)
+{
+	struct mdp4_commit_ctrl *cc =
+		container_of(work, struct mdp4_commit_ctrl, work);
+	struct msm_fb_data_type *mfd = cc->mfd;
+	int i;
+
+	mutex_lock(&mfd->dma->ov_mutex);
+
+	/* a panel being blanked gets no more vsyncs to wait for */
+	if (mfd->panel_power_on)
+		mdp4_overlay_commit_wait(mfd, cc->pipe[0]);
+	mdp4_iommu_unmap(cc->pipe[0]);
+
+	for (i = 0; i < cc->npipes; i++)
+		mdp4_overlay_play_account(cc->pipe[i], cc->queue, cc->kickoff);
+#ifdef CONFIG_SW_SYNC
+	if (cc->timeline)
+		sw_sync_timeline_inc(cc->timeline, 1);
+#endif
+
+	mutex_unlock(&mfd->dma->ov_mutex);
+}
+
+#ifdef CONFIG_SW_SYNC
+static int mdp4_overlay_commit_fence(struct mdp4_commit_ctrl *cc,
+				     int mixer_num, u32 value)
+{
+	char name[16];
+	struct sync_pt *pt;
+	struct sync_fence *fence;
+	int fd;
+
+	if (!cc->timeline) {
+		snprintf(name, sizeof(name), "mdp4_mixer%d", mixer_num);
+		cc->timeline = sw_sync_timeline_create(name);
+		if (!cc->timeline)
+			return -ENOMEM;
+		/* catch up with the commits displayed without a timeline */
+		if (cc->frame > 1)
+			sw_sync_timeline_inc(cc->timeline, cc->frame - 1);
+	}
+
+	fd = get_unused_fd();
+	if (fd < 0)
+		return fd;
+
+	pt = sw_sync_pt_create(cc->timeline, value);
+	if (!pt)
+		goto err;
+
+	fence = sync_fence_create("mdp4_release", pt);
+	if (!fence) {
+		sync_pt_free(pt);
+		goto err;
+	}
+
+	sync_fence_install(fence, fd);
+	return fd;
+err:
+	put_unused_fd(fd);
+	return -ENOMEM;
+}
+#endif
+
+int mdp4_overlay_commit(struct fb_info *info, struct msmfb_overlay_commit *req)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp4_overlay_pipe *pipe[MSMFB_OVERLAY_COMMIT_MAX];
+	struct mdp4_play_buf buf[MSMFB_OVERLAY_COMMIT_MAX];
+	struct mdp4_commit_ctrl *cc;
+	ktime_t queue;
+	int i, mixer, ret = 0;
+#ifdef CONFIG_SW_SYNC
+	int fd;
+#endif
+
+	queue = ktime_get();
+
+	if (mfd == NULL)
+		return -ENODEV;
+
+	if (!mfd->panel_power_on) /* suspended */
+		return -EPERM;
+
+	if (req->flags || req->num_pipes == 0 ||
+	    req->num_pipes > MSMFB_OVERLAY_COMMIT_MAX)
+		return -EINVAL;
+
+	mixer = mfd->panel_info.pdest;
+	if (mixer != MDP4_MIXER0 && mixer != MDP4_MIXER1)
+		return -EINVAL;
+
+	for (i = 0; i < req->num_pipes; i++) {
+		pipe[i] = mdp4_overlay_ndx2pipe(req->data[i].id);
+		if (pipe[i] == NULL) {
+			mdp4_stat.err_play++;
+			return -ENODEV;
+		}
+		/* one frame of one mixer, the one this fb scans out */
+		if (pipe[i]->mixer_num != mixer)
+			return -EINVAL;
+	}
+
+	cc = &mdp4_commit_db[mixer];
+	flush_work(&cc->work);
+
+	if (mutex_lock_interruptible(&mfd->dma->ov_mutex))
+		return -EINTR;
+
+	/* resolve every buffer before touching a pipe: all or nothing */
+	memset(buf, 0, sizeof(buf));
+	for (i = 0; i < req->num_pipes; i++) {
+		ret = mdp4_overlay_play_resolve(info, pipe[i], &req->data[i],
+						&buf[i]);
+		if (ret)
+			goto unlock;
+	}
+	for (i = 0; i < req->num_pipes; i++)
+		mdp4_overlay_play_setup(mfd, pipe[i], &buf[i]);
+
+	cc->kickoff = ktime_get();
+	mdp4_overlay_commit_kickoff(mfd, pipe[0]);
+	for (i = 0; i < req->num_pipes; i++) {
+		/* write out DPP HSIC registers */
+		if (pipe[i]->flags & MDP_DPP_HSIC)
+			mdp4_hsic_update(pipe[i]);
+		cc->pipe[i] = pipe[i];
+	}
+	mdp4_stat.overlay_play[mixer] += req->num_pipes;
+
+	cc->mfd = mfd;
+	cc->npipes = req->num_pipes;
+	cc->queue = queue;
+	req->frame = ++cc->frame;
+	req->release_fence_fd = -1;
+#ifdef CONFIG_SW_SYNC
+	/* the frame is queued regardless, only the fence would be missing */
+	fd = mdp4_overlay_commit_fence(cc, mixer, cc->frame + 1);
+	if (fd < 0)
+		pr_err("%s: no release fence (%d)\n", __func__, fd);
+	else
+		req->release_fence_fd = fd;
+#endif
+	schedule_work(&cc->work);
+unlock:
+	mutex_unlock(&mfd->dma->ov_mutex);
+	for (i = 0; i < req->num_pipes; i++)
+		mdp4_overlay_play_put(&buf[i]);
 	return ret;
 }
 
+/*
+ * Called before @mfd's panel is turned off: wait for the queued commit and
+ * release the buffers of the last one, which are not scanned out anymore.
+ */
+void mdp4_overlay_commit_flush(struct msm_fb_data_type *mfd)
+{
+	struct mdp4_commit_ctrl *cc;
+	int mixer = mfd->panel_info.pdest;
+
+	if (mixer != MDP4_MIXER0 && mixer != MDP4_MIXER1)
+		return;
+
+	cc = &mdp4_commit_db[mixer];
+	flush_work(&cc->work);
+
+	mutex_lock(&mfd->dma->ov_mutex);
+	cc->frame++;
+#ifdef CONFIG_SW_SYNC
+	if (cc->timeline)
+		sw_sync_timeline_inc(cc->timeline, 1);
+#endif
+	mutex_unlock(&mfd->dma->ov_mutex);
+}
+
 static struct {
 	char *name;
 	int  domain;
@@ -0,0 +1,77 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#if !defined(_MDP4_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MDP4_TRACE_H
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mdp4
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mdp4_trace
+
+#include <linux/tracepoint.h>
+#include <linux/ktime.h>
+
+/*
+ * Tracepoint for a completed overlay play or commit.  @queue is when the
+ * request entered the driver, @kickoff when the pipe was staged and the
+ * hardware was started, @vsync when the mixer's vsync (dma done on command
+ * mode panels) that latched it fired, and @done when the play returned or
+ * the commit's buffers were released.  @vsync is 0 if no interrupt was
+ * waited for (MDP_OV_PLAY_NOWAIT).
+ */
+TRACE_EVENT(mdp4_overlay_play,
+
+	TP_PROTO(int pipe_ndx, int mixer_num, ktime_t queue, ktime_t kickoff,
+		 ktime_t vsync, ktime_t done),
+
+	TP_ARGS(pipe_ndx, mixer_num, queue, kickoff, vsync, done),
+
+	TP_STRUCT__entry(
+		__field(int, pipe_ndx)
+		__field(int, mixer_num)
+		__field(s64, queue)
+		__field(s64, kickoff)
+		__field(s64, vsync)
+		__field(s64, done)
+	),
+
+	TP_fast_assign(
+		__entry->pipe_ndx = pipe_ndx;
+		__entry->mixer_num = mixer_num;
+		__entry->queue = ktime_to_us(queue);
+		__entry->kickoff = ktime_to_us(kickoff);
+		__entry->vsync = ktime_to_us(vsync);
+		__entry->done = ktime_to_us(done);
+	),
+
+	TP_printk(
+		"pipe=%d mixer=%d queue=%lld kickoff=%lld vsync=%lld done=%lld "
+		"setup_us=%lld wait_us=%lld",
+		__entry->pipe_ndx,
+		__entry->mixer_num,
+		__entry->queue,
+		__entry->kickoff,
+		__entry->vsync,
+		__entry->done,
+		__entry->kickoff - __entry->queue,
+		__entry->done - __entry->kickoff
+	)
+);
+
+#endif /* _MDP4_TRACE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -34,6 +34,7 @@
 #include "mdp4.h"
 
 struct mdp4_statistic mdp4_stat;
+ktime_t mdp4_vsync_time[MDP4_MIXER_MAX];
 
 unsigned is_mdp4_hw_reset(void)
 {
@@ -384,6 +385,19 @@ int is_fps_ok(void)
 		return 0;
 }
 #endif
+/*
+ * ktime_t is 64 bits and can tear on 32 bit cpus, so stamp and read it
+ * under mdp_spin_lock.  Called from the isr only.
+ */
+static void mdp4_vsync_stamp(int mixer)
+{
+	ktime_t now = ktime_get();
+
+	spin_lock(&mdp_spin_lock);
+	mdp4_vsync_time[mixer] = now;
+	spin_unlock(&mdp_spin_lock);
+}
+
 irqreturn_t mdp4_isr(int irq, void *ptr)
 {
 	uint32 isr, mask, panel;
@@ -438,6 +452,7 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 	panel = mdp4_overlay_panel_list();
 	if (isr & INTR_PRIMARY_VSYNC) {
 		mdp4_stat.intr_vsync_p++;
+		mdp4_vsync_stamp(MDP4_MIXER0);
 		dma = &dma2_data;
 		spin_lock(&mdp_spin_lock);
 		mdp_intr_mask &= ~INTR_PRIMARY_VSYNC;
@@ -454,6 +469,7 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 #ifdef CONFIG_FB_MSM_DTV
 	if (isr & INTR_EXTERNAL_VSYNC) {
 		mdp4_stat.intr_vsync_e++;
+		mdp4_vsync_stamp(MDP4_MIXER1);
 		dma = &dma_e_data;
 		spin_lock(&mdp_spin_lock);
 		mdp_intr_mask &= ~INTR_EXTERNAL_VSYNC;
@@ -495,6 +511,7 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 	}
 	if (isr & INTR_OVERLAY1_DONE) {
 		mdp4_stat.intr_overlay1++;
+		mdp4_vsync_stamp(MDP4_MIXER1);
 		/* disable DTV interrupt */
 		dma = &dma_e_data;
 		spin_lock(&mdp_spin_lock);
@@ -529,6 +546,7 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 
 	if (isr & INTR_DMA_P_DONE) {
 		mdp4_stat.intr_dma_p++;
+		mdp4_vsync_stamp(MDP4_MIXER0);
 		dma = &dma2_data;
 		if (panel & MDP4_PANEL_LCDC) {
 			/* disable LCDC interrupt */
@@ -38,7 +38,7 @@
 #include "hdmi_msm.h"
 #endif
 
-#define MDP_DEBUG_BUF	2048
+#define MDP_DEBUG_BUF	4096
 
 static uint32	mdp_offset;
 static uint32	mdp_count;
@@ -271,6 +271,7 @@ static ssize_t mdp_stat_read(
 	int len = 0;
 	int tot = 0;
 	int dlen;
+	int i;
 	char *bp;
 
 
@@ -476,6 +477,16 @@ static ssize_t mdp_stat_read(
 	bp += len;
 	dlen -= len;
 
+	len = snprintf(bp, dlen, "iommu_map:\n");
+	bp += len;
+	dlen -= len;
+	len = snprintf(bp, dlen, "map:   %08lu\t", mdp4_stat.iommu_map);
+	bp += len;
+	dlen -= len;
+	len = snprintf(bp, dlen, "map_us: %08lu\n\n", mdp4_stat.iommu_map_us);
+	bp += len;
+	dlen -= len;
+
 	len = snprintf(bp, dlen, "writeback:\n");
 	bp += len;
 	dlen -= len;
@@ -505,6 +516,28 @@ static ssize_t mdp_stat_read(
 	bp += len;
 	dlen -= len;
 
+	len = snprintf(bp, dlen,
+		       "play_latency (ms):  setup     vsync     wait\n");
+	bp += len;
+	dlen -= len;
+	for (i = 0; i < MDP4_PLAY_HIST_MAX; i++) {
+		if (i == MDP4_PLAY_HIST_MAX - 1)
+			len = snprintf(bp, dlen, ">= %3d:   ", (1 << (i - 1)));
+		else
+			len = snprintf(bp, dlen, "<  %3d:   ", (1 << i));
+		bp += len;
+		dlen -= len;
+		len = snprintf(bp, dlen, "%08lu  %08lu  %08lu\n",
+			       mdp4_stat.play_setup_hist[i],
+			       mdp4_stat.play_vsync_hist[i],
+			       mdp4_stat.play_wait_hist[i]);
+		bp += len;
+		dlen -= len;
+	}
+	len = snprintf(bp, dlen, "\n");
+	bp += len;
+	dlen -= len;
+
 	tot = (uint32)bp - (uint32)debug_buf;
 	*bp = 0;
 	tot++;
@@ -898,6 +898,9 @@ static int msm_fb_blank_sub(int blank_mode, struct fb_info *info,
 			// pan  bl_updated = 0;
 
 			msleep(16);
+#ifdef CONFIG_FB_MSM_OVERLAY
+			mdp4_overlay_commit_flush(mfd);
+#endif
 			ret = pdata->off(mfd->pdev);
 			if (ret)
 				mfd->panel_power_on = curr_pwr_state;
@@ -2901,22 +2904,10 @@ static int msmfb_overlay_play_wait(struct fb_info *info, unsigned long *argp)
 	return ret;
 }
 
-static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+/* kick the update notifier and bring up a primary left on by the splash */
+static int msmfb_overlay_update_notify(struct fb_info *info)
 {
-	int	ret;
-	struct msmfb_overlay_data req;
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
-	//pan struct msm_fb_panel_data *pdata;
-
-	if (mfd->overlay_play_enable == 0)	/* nothing to do */
-		return 0;
-
-	ret = copy_from_user(&req, argp, sizeof(req));
-	if (ret) {
-		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
-			__func__);
-		return ret;
-	}
 
 	complete(&mfd->msmfb_update_notify);
 	mutex_lock(&msm_fb_notify_update_sem);
@@ -2936,6 +2927,30 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 		}
 	}
 
+	return 0;
+}
+
+static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+{
+	int	ret;
+	struct msmfb_overlay_data req;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	//pan struct msm_fb_panel_data *pdata;
+
+	if (mfd->overlay_play_enable == 0)	/* nothing to do */
+		return 0;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
+			__func__);
+		return ret;
+	}
+
+	ret = msmfb_overlay_update_notify(info);
+	if (ret)
+		return ret;
+
 	ret = mdp4_overlay_play(info, &req);
 
 #if 0//back
@@ -2955,6 +2970,35 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 	return ret;
 }
 
+static int msmfb_overlay_commit(struct fb_info *info, unsigned long *argp)
+{
+	int	ret;
+	struct msmfb_overlay_commit req;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	if (mfd->overlay_play_enable == 0)	/* nothing to do */
+		return 0;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		pr_err("%s: failed\n", __func__);
+		return -EFAULT;
+	}
+
+	ret = msmfb_overlay_update_notify(info);
+	if (ret)
+		return ret;
+
+	ret = mdp4_overlay_commit(info, &req);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(argp, &req, sizeof(req)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int msmfb_overlay_play_enable(struct fb_info *info, unsigned long *argp)
 {
 	int	ret, enable;
@@ -3332,6 +3376,11 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 		ret = msmfb_overlay_play(info, argp);
 		up(&msm_fb_ioctl_ppp_sem);
 		break;
+	case MSMFB_OVERLAY_COMMIT:
+		down(&msm_fb_ioctl_ppp_sem);
+		ret = msmfb_overlay_commit(info, argp);
+		up(&msm_fb_ioctl_ppp_sem);
+		break;
 	case MSMFB_OVERLAY_PLAY_ENABLE:
 		down(&msm_fb_ioctl_ppp_sem);
 		ret = msmfb_overlay_play_enable(info, argp);
@@ -0,0 +1,437 @@
+/*
+ *  linux/fs/ext4/discard.c
+ *
+ * Idle time discard (discard=idle): instead of issuing a discard for every
+ * extent freed by a commit, as -o discard does, the extents are queued in
+ * an rbtree where neighbours are merged into larger ranges.  A work item
+ * issues them once the disk has seen no I/O for s_idle_discard_ms, at most
+ * s_idle_discard_batch blocks per idle window, and backs off as soon as
+ * other I/O shows up or the system starts to suspend.  At most
+ * s_idle_discard_max_ranges ranges are kept; once the tree is full, freed
+ * extents are discarded at commit time as with -o discard.
+ *
+ * Ranges are discarded through ext4_mb_discard_free(), so blocks that were
+ * allocated again before their turn came are left alone.
+ */
+
+#include <linux/fs.h>
+#include <linux/genhd.h>
+#include <linux/blkdev.h>
+#include <linux/slab.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/suspend.h>
+#include <linux/ktime.h>
+#include "ext4.h"
+
+struct ext4_discard_range {
+	struct rb_node	node;
+	ext4_fsblk_t	start;
+	ext4_fsblk_t	count;
+};
+
+static inline struct ext4_idle_discard *EXT4_ID(struct super_block *sb)
+{
+	return &EXT4_SB(sb)->s_idle_discard;
+}
+
+/*
+ * Add [start, start + count) to the tree, merging it with the ranges it
+ * overlaps or touches.  Returns 1 if @new was linked into the tree, 0 if
+ * it was merged and can be freed.  Called with id_lock held.
+ */
+static int ext4_idle_discard_insert(struct ext4_idle_discard *id,
+				    struct ext4_discard_range *new)
+{
+	struct rb_node **n = &id->id_root.rb_node, *parent = NULL, *node;
+	struct ext4_discard_range *entry, *range = NULL;
+	ext4_fsblk_t end = new->start + new->count;
+
+	while (*n) {
+		parent = *n;
+		entry = rb_entry(parent, struct ext4_discard_range, node);
+		if (end < entry->start)
+			n = &(*n)->rb_left;
+		else if (new->start > entry->start + entry->count)
+			n = &(*n)->rb_right;
+		else {
+			range = entry;
+			break;
+		}
+	}
+
+	if (!range) {
+		rb_link_node(&new->node, parent, n);
+		rb_insert_color(&new->node, &id->id_root);
+		id->id_pending += new->count;
+		id->id_nr_ranges++;
+		return 1;
+	}
+
+	/* Grow the range we hit, then swallow the neighbours it reaches */
+	id->id_merged++;
+	id->id_pending -= range->count;
+	if (new->start < range->start) {
+		range->count += range->start - new->start;
+		range->start = new->start;
+	}
+	if (end > range->start + range->count)
+		range->count = end - range->start;
+
+	while ((node = rb_prev(&range->node))) {
+		entry = rb_entry(node, struct ext4_discard_range, node);
+		if (entry->start + entry->count < range->start)
+			break;
+		id->id_pending -= entry->count;
+		if (entry->start < range->start) {
+			range->count += range->start - entry->start;
+			range->start = entry->start;
+		}
+		rb_erase(node, &id->id_root);
+		kfree(entry);
+		id->id_nr_ranges--;
+	}
+	while ((node = rb_next(&range->node))) {
+		entry = rb_entry(node, struct ext4_discard_range, node);
+		if (entry->start > range->start + range->count)
+			break;
+		id->id_pending -= entry->count;
+		if (entry->start + entry->count > range->start + range->count)
+			range->count = entry->start + entry->count -
+				       range->start;
+		rb_erase(node, &id->id_root);
+		kfree(entry);
+		id->id_nr_ranges--;
+	}
+	id->id_pending += range->count;
+	return 0;
+}
+
+/*
+ * Called from the commit callback for every extent the commit freed.
+ * Returns non-zero if the extent could not be queued, because the tree
+ * is full or memory is short; the caller then discards it right away.
+ */
+int ext4_idle_discard_queue(struct super_block *sb, ext4_group_t group,
+			    ext4_grpblk_t start, ext4_grpblk_t count)
+{
+	struct ext4_idle_discard *id = EXT4_ID(sb);
+	struct ext4_discard_range *new;
+	int full;
+
+	if (!blk_queue_discard(bdev_get_queue(sb->s_bdev)))
+		return 0;
+
+	spin_lock(&id->id_lock);
+	full = id->id_nr_ranges >= EXT4_SB(sb)->s_idle_discard_max_ranges;
+	spin_unlock(&id->id_lock);
+
+	new = full ? NULL : kmalloc(sizeof(*new), GFP_NOFS);
+	if (!new) {
+		spin_lock(&id->id_lock);
+		id->id_sync += count;
+		spin_unlock(&id->id_lock);
+		return -ENOSPC;
+	}
+	new->start = ext4_group_first_block_no(sb, group) + start;
+	new->count = count;
+
+	spin_lock(&id->id_lock);
+	id->id_queued += count;
+	if (!ext4_idle_discard_insert(id, new))
+		kfree(new);
+	spin_unlock(&id->id_lock);
+
+	queue_delayed_work(system_freezable_wq, &id->id_work,
+			   msecs_to_jiffies(EXT4_SB(sb)->s_idle_discard_ms));
+	return 0;
+}
+
+static unsigned long ext4_idle_discard_ios(struct hd_struct *part)
+{
+	return part_stat_read(part, ios[READ]) +
+	       part_stat_read(part, ios[WRITE]);
+}
+
+/*
+ * The whole disk counts, not just our partition: on eMMC the other
+ * partitions compete for the same device.
+ */
+static struct hd_struct *ext4_idle_discard_part(struct super_block *sb)
+{
+	return &sb->s_bdev->bd_disk->part0;
+}
+
+/* Discard what is still free of [block, block + count), group by group */
+static ext4_fsblk_t ext4_idle_discard_issue(struct super_block *sb,
+					    ext4_fsblk_t block,
+					    ext4_fsblk_t count)
+{
+	ext4_fsblk_t discarded = 0;
+	ext4_group_t group;
+	ext4_grpblk_t offset, n;
+
+	while (count) {
+		ext4_get_group_no_and_offset(sb, block, &group, &offset);
+		n = min_t(ext4_fsblk_t, count,
+			  EXT4_BLOCKS_PER_GROUP(sb) - offset);
+		discarded += ext4_mb_discard_free(sb, group, offset, n);
+		block += n;
+		count -= n;
+	}
+	return discarded;
+}
+
+static void ext4_idle_discard_work(struct work_struct *work)
+{
+	struct ext4_idle_discard *id = container_of(to_delayed_work(work),
+					struct ext4_idle_discard, id_work);
+	struct super_block *sb = id->id_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct hd_struct *part = ext4_idle_discard_part(sb);
+	struct ext4_discard_range *entry;
+	struct rb_node *node;
+	ext4_fsblk_t block, count, done;
+	unsigned long ios, reads, budget;
+	ktime_t start;
+	u64 us;
+	int pending;
+
+	mutex_lock(&id->id_mutex);
+	if (id->id_suspending || (sb->s_flags & MS_RDONLY))
+		goto out;
+
+	/* Any I/O since the last look means the disk was not idle */
+	ios = ext4_idle_discard_ios(part);
+	if (ios != id->id_last_ios || part_in_flight(part)) {
+		id->id_last_ios = ios;
+		goto requeue;
+	}
+
+	id->id_batches++;
+	reads = part_stat_read(part, ios[READ]);
+	budget = max(sbi->s_idle_discard_batch, 1U);
+	while (budget) {
+		spin_lock(&id->id_lock);
+		node = rb_first(&id->id_root);
+		if (!node) {
+			spin_unlock(&id->id_lock);
+			break;
+		}
+		entry = rb_entry(node, struct ext4_discard_range, node);
+		block = entry->start;
+		count = min_t(ext4_fsblk_t, entry->count, budget);
+		entry->start += count;
+		entry->count -= count;
+		if (!entry->count) {
+			rb_erase(node, &id->id_root);
+			kfree(entry);
+			id->id_nr_ranges--;
+		}
+		id->id_pending -= count;
+		spin_unlock(&id->id_lock);
+
+		start = ktime_get();
+		done = ext4_idle_discard_issue(sb, block, count);
+		us = ktime_us_delta(ktime_get(), start);
+
+		id->id_ranges++;
+		id->id_discarded += done;
+		id->id_reused += count - done;
+		id->id_total_us += us;
+		if (us > id->id_max_us)
+			id->id_max_us = us;
+		budget -= count;
+
+		if (id->id_suspending)
+			break;
+		/*
+		 * Our own discards have completed by now and they only show
+		 * up as writes: reads, or anything still in flight, are
+		 * somebody else's.
+		 */
+		if (part_in_flight(part) ||
+		    part_stat_read(part, ios[READ]) != reads) {
+			id->id_aborted++;
+			break;
+		}
+	}
+	id->id_last_ios = ext4_idle_discard_ios(part);
+
+requeue:
+	spin_lock(&id->id_lock);
+	pending = id->id_pending != 0;
+	spin_unlock(&id->id_lock);
+	if (pending)
+		queue_delayed_work(system_freezable_wq, &id->id_work,
+				   msecs_to_jiffies(sbi->s_idle_discard_ms));
+out:
+	mutex_unlock(&id->id_mutex);
+}
+
+static int ext4_idle_discard_pm_notify(struct notifier_block *nb,
+				       unsigned long action, void *data)
+{
+	struct ext4_idle_discard *id = container_of(nb,
+					struct ext4_idle_discard, id_pm_nb);
+	struct super_block *sb = id->id_sb;
+
+	switch (action) {
+	case PM_HIBERNATION_PREPARE:
+	case PM_SUSPEND_PREPARE:
+		/* A batch in progress stops after its current range */
+		id->id_suspending = 1;
+		cancel_delayed_work(&id->id_work);
+		break;
+	case PM_POST_HIBERNATION:
+	case PM_POST_SUSPEND:
+		id->id_suspending = 0;
+		id->id_last_ios =
+			ext4_idle_discard_ios(ext4_idle_discard_part(sb));
+		queue_delayed_work(system_freezable_wq, &id->id_work,
+			msecs_to_jiffies(EXT4_SB(sb)->s_idle_discard_ms));
+		break;
+	}
+	return NOTIFY_DONE;
+}
+
+static int ext4_idle_discard_seq_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_idle_discard *id = EXT4_ID(sb);
+	ext4_fsblk_t pending;
+	unsigned int nr_ranges;
+	u64 queued, merged, sync;
+
+	spin_lock(&id->id_lock);
+	pending = id->id_pending;
+	nr_ranges = id->id_nr_ranges;
+	queued = id->id_queued;
+	merged = id->id_merged;
+	sync = id->id_sync;
+	spin_unlock(&id->id_lock);
+
+	seq_printf(seq, "queued_blocks:    %llu\n", queued);
+	seq_printf(seq, "merged_ranges:    %llu\n", merged);
+	seq_printf(seq, "sync_blocks:      %llu\n", sync);
+	seq_printf(seq, "pending_blocks:   %llu\n",
+		   (unsigned long long) pending);
+	seq_printf(seq, "pending_ranges:   %u\n", nr_ranges);
+
+	mutex_lock(&id->id_mutex);
+	seq_printf(seq, "discarded_bytes:  %llu\n",
+		   id->id_discarded << sb->s_blocksize_bits);
+	seq_printf(seq, "reused_blocks:    %llu\n", id->id_reused);
+	seq_printf(seq, "batches:          %llu\n", id->id_batches);
+	seq_printf(seq, "aborted_batches:  %llu\n", id->id_aborted);
+	seq_printf(seq, "discards:         %llu\n", id->id_ranges);
+	seq_printf(seq, "discard_us_total: %llu\n", id->id_total_us);
+	seq_printf(seq, "discard_us_max:   %llu\n", id->id_max_us);
+	mutex_unlock(&id->id_mutex);
+	return 0;
+}
+
+static int ext4_idle_discard_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_idle_discard_seq_show, PDE(inode)->data);
+}
+
+static const struct file_operations ext4_idle_discard_seq_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ext4_idle_discard_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Drop everything still queued; the groups are not marked trimmed */
+static void ext4_idle_discard_drop(struct ext4_idle_discard *id)
+{
+	struct ext4_discard_range *entry;
+	struct rb_node *node;
+
+	spin_lock(&id->id_lock);
+	while ((node = rb_first(&id->id_root))) {
+		entry = rb_entry(node, struct ext4_discard_range, node);
+		rb_erase(node, &id->id_root);
+		kfree(entry);
+	}
+	id->id_pending = 0;
+	id->id_nr_ranges = 0;
+	spin_unlock(&id->id_lock);
+}
+
+/*
+ * The PM notifier and the proc file only exist while discard=idle is in
+ * effect.  Called at mount and after every remount, with s_umount held.
+ */
+void ext4_idle_discard_update(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_idle_discard *id = EXT4_ID(sb);
+	int enable = test_opt2(sb, IDLE_DISCARD) ? 1 : 0;
+
+	if (enable == id->id_enabled)
+		return;
+	id->id_enabled = enable;
+
+	if (enable) {
+		id->id_suspending = 0;
+		id->id_last_ios =
+			ext4_idle_discard_ios(ext4_idle_discard_part(sb));
+		register_pm_notifier(&id->id_pm_nb);
+		if (sbi->s_proc)
+			proc_create_data("idle_discard", S_IRUGO, sbi->s_proc,
+					 &ext4_idle_discard_seq_fops, sb);
+		return;
+	}
+
+	if (sbi->s_proc)
+		remove_proc_entry("idle_discard", sbi->s_proc);
+	unregister_pm_notifier(&id->id_pm_nb);
+	cancel_delayed_work_sync(&id->id_work);
+	ext4_idle_discard_drop(id);
+}
+
+void ext4_idle_discard_init(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_idle_discard *id = EXT4_ID(sb);
+
+	sbi->s_idle_discard_ms = EXT4_DEF_IDLE_DISCARD_MS;
+	sbi->s_idle_discard_batch = EXT4_DEF_IDLE_DISCARD_BATCH;
+	sbi->s_idle_discard_max_ranges = EXT4_DEF_IDLE_DISCARD_MAX_RANGES;
+
+	id->id_sb = sb;
+	spin_lock_init(&id->id_lock);
+	id->id_root = RB_ROOT;
+	INIT_DELAYED_WORK(&id->id_work, ext4_idle_discard_work);
+	mutex_init(&id->id_mutex);
+	id->id_pm_nb.notifier_call = ext4_idle_discard_pm_notify;
+
+	ext4_idle_discard_update(sb);
+}
+
+/*
+ * Ranges still pending at unmount are dropped; their groups are not marked
+ * trimmed, so the next FITRIM covers them.
+ */
+void ext4_idle_discard_release(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_idle_discard *id = EXT4_ID(sb);
+
+	/* ext4_mb_init() failed before getting here */
+	if (!id->id_sb)
+		return;
+
+	if (id->id_enabled) {
+		if (sbi->s_proc)
+			remove_proc_entry("idle_discard", sbi->s_proc);
+		unregister_pm_notifier(&id->id_pm_nb);
+		id->id_enabled = 0;
+	}
+	/* A commit may have raced with a remount that turned it off */
+	cancel_delayed_work_sync(&id->id_work);
+	ext4_idle_discard_drop(id);
+}
@@ -27,6 +27,8 @@
 #include <linux/mutex.h>
 #include <linux/timer.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
 #include <linux/blockgroup_lock.h>
 #include <linux/percpu_counter.h>
 #ifdef __KERNEL__
@@ -917,6 +919,11 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DISCARD		0x40000000 /* Issue DISCARD requests */
 #define EXT4_MOUNT_INIT_INODE_TABLE	0x80000000 /* Initialize uninitialized itables */
 
+/*
+ * Mount flags set via s_mount_opt2
+ */
+#define EXT4_MOUNT2_IDLE_DISCARD	0x00000001 /* Discard when disk idle */
+
 #define clear_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt &= \
 						~EXT4_MOUNT_##opt
 #define set_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt |= \
@@ -1076,6 +1083,36 @@ struct ext4_super_block {
 #define EXT4_MF_MNTDIR_SAMPLED	0x0001
 #define EXT4_MF_FS_ABORTED	0x0002	/* Fatal error detected */
 
+/*
+ * Freed blocks waiting to be discarded while the disk is idle
+ * (discard=idle, see discard.c)
+ */
+struct ext4_idle_discard {
+	struct super_block	*id_sb;
+	spinlock_t		id_lock;	/* id_root and id_pending */
+	struct rb_root		id_root;	/* pending ranges by start */
+	ext4_fsblk_t		id_pending;	/* blocks in id_root */
+	unsigned int		id_nr_ranges;	/* ranges in id_root */
+	struct delayed_work	id_work;
+	struct mutex		id_mutex;	/* serializes batches */
+	struct notifier_block	id_pm_nb;
+	int			id_enabled;	/* pm notifier, proc file */
+	int			id_suspending;
+	unsigned long		id_last_ios;	/* disk I/Os at last check */
+
+	/* statistics: queueing ones under id_lock, the rest id_mutex */
+	u64			id_queued;	/* blocks queued */
+	u64			id_merged;	/* ranges merged on queueing */
+	u64			id_sync;	/* discarded at commit instead */
+	u64			id_discarded;	/* blocks discarded */
+	u64			id_reused;	/* blocks reallocated first */
+	u64			id_batches;	/* idle windows used */
+	u64			id_aborted;	/* batches cut short by I/O */
+	u64			id_ranges;	/* discard calls issued */
+	u64			id_total_us;	/* time spent discarding */
+	u64			id_max_us;	/* longest single discard */
+};
+
 /*
  * fourth extended-fs super-block data in memory
  */
@@ -1172,6 +1209,9 @@ struct ext4_sb_info {
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
 	unsigned int s_max_writeback_mb_bump;
+	unsigned int s_idle_discard_ms;
+	unsigned int s_idle_discard_batch;
+	unsigned int s_idle_discard_max_ranges;
 	/* where last allocation was done - for stream allocation */
 	unsigned long s_mb_last_group;
 	unsigned long s_mb_last_start;
@@ -1218,6 +1258,9 @@ struct ext4_sb_info {
 
 	/* record the last minlen when FITRIM is called. */
 	atomic_t s_last_trim_minblks;
+
+	/* discard=idle state */
+	struct ext4_idle_discard s_idle_discard;
 };
 
 static inline struct ext4_sb_info *EXT4_SB(struct super_block *sb)
@@ -1408,6 +1451,13 @@ static inline void ext4_clear_state_flags(struct ext4_inode_info *ei)
 
 #define EXT4_DEF_INODE_READAHEAD_BLKS	32
 
+/*
+ * Default discard=idle tunables
+ */
+#define EXT4_DEF_IDLE_DISCARD_MS	1000
+#define EXT4_DEF_IDLE_DISCARD_BATCH	8192
+#define EXT4_DEF_IDLE_DISCARD_MAX_RANGES	4096
+
 /*
  * Default mount options
  */
@@ -1800,6 +1850,10 @@ extern int ext4_mb_add_groupinfo(struct super_block *sb,
 extern void ext4_add_groupblocks(handle_t *handle, struct super_block *sb,
 				ext4_fsblk_t block, unsigned long count);
 extern int ext4_trim_fs(struct super_block *, struct fstrim_range *);
+extern ext4_grpblk_t ext4_mb_discard_free(struct super_block *sb,
+					  ext4_group_t group,
+					  ext4_grpblk_t start,
+					  ext4_grpblk_t count);
 
 /* inode.c */
 struct buffer_head *ext4_getblk(handle_t *, struct inode *,
@@ -2205,6 +2259,14 @@ extern int ext4_bio_write_page(struct ext4_io_submit *io,
 /* mmp.c */
 extern int ext4_multi_mount_protect(struct super_block *, ext4_fsblk_t);
 
+/* discard.c */
+extern void ext4_idle_discard_init(struct super_block *sb);
+extern void ext4_idle_discard_update(struct super_block *sb);
+extern void ext4_idle_discard_release(struct super_block *sb);
+extern int ext4_idle_discard_queue(struct super_block *sb,
+				   ext4_group_t group,
+				   ext4_grpblk_t start, ext4_grpblk_t count);
+
 /* BH_Uninit flag: blocks are allocated but uninitialized on disk */
 enum ext4_state_bits {
 	BH_Uninit	/* blocks are allocated but uninitialized on disk */
@@ -2495,6 +2495,8 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
 
+	ext4_idle_discard_init(sb);
+
 	if (sbi->s_journal)
 		sbi->s_journal->j_commit_callback = release_blocks_on_commit;
 out:
@@ -2532,6 +2534,7 @@ int ext4_mb_release(struct super_block *sb)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	struct kmem_cache *cachep = get_groupinfo_cache(sb->s_blocksize_bits);
 
+	ext4_idle_discard_release(sb);
 	if (sbi->s_proc)
 		remove_proc_entry("mb_groups", sbi->s_proc);
 
@@ -2616,7 +2619,10 @@ static void release_blocks_on_commit(journal_t *journal, transaction_t *txn)
 		mb_debug(1, "gonna free %u blocks in group %u (0x%p):",
 			 entry->count, entry->group, entry);
 
-		if (test_opt(sb, DISCARD))
+		if (test_opt(sb, DISCARD) ||
+		    (test_opt2(sb, IDLE_DISCARD) &&
+		     ext4_idle_discard_queue(sb, entry->group,
+					     entry->start_blk, entry->count)))
 			ext4_issue_discard(sb, entry->group,
 					   entry->start_blk, entry->count);
 
@@ -4898,6 +4904,53 @@ out:
 	return count;
 }
 
+/**
+ * ext4_mb_discard_free -- discard the blocks of a range that are still free
+ * @sb:			super block for file system
+ * @group:		alloc. group the range lies in
+ * @start:		first group block of the range
+ * @count:		number of blocks in the range
+ *
+ * Used by the idle discard scheduler for ranges freed some time ago: blocks
+ * that were allocated again in the meantime are skipped, the free extents
+ * left are trimmed with ext4_trim_extent.  Returns the number of blocks
+ * discarded.
+ */
+ext4_grpblk_t ext4_mb_discard_free(struct super_block *sb, ext4_group_t group,
+				   ext4_grpblk_t start, ext4_grpblk_t count)
+{
+	void *bitmap;
+	ext4_grpblk_t next, max = start + count, discarded = 0;
+	struct ext4_buddy e4b;
+
+	if (unlikely(EXT4_MB_GRP_NEED_INIT(ext4_get_group_info(sb, group))) &&
+	    ext4_mb_init_group(sb, group))
+		return 0;
+
+	if (ext4_mb_load_buddy(sb, group, &e4b)) {
+		ext4_error(sb, "Error in loading buddy "
+				"information for %u", group);
+		return 0;
+	}
+	bitmap = e4b.bd_bitmap;
+
+	ext4_lock_group(sb, group);
+	while (start < max) {
+		start = mb_find_next_zero_bit(bitmap, max, start);
+		if (start >= max)
+			break;
+		next = mb_find_next_bit(bitmap, max, start);
+
+		ext4_trim_extent(sb, start, next - start, group, &e4b);
+		discarded += next - start;
+		start = next + 1;
+	}
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(&e4b);
+
+	return discarded;
+}
+
 /**
  * ext4_trim_fs() -- trim ioctl handle function
  * @sb:			superblock for filesystem
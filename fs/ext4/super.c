@@ -1103,6 +1103,9 @@ static int ext4_show_options(struct seq_file *seq, struct vfsmount *vfs)
 	if (test_opt(sb, DISCARD) && !(def_mount_opts & EXT4_DEFM_DISCARD))
 		seq_puts(seq, ",discard");
 
+	if (test_opt2(sb, IDLE_DISCARD))
+		seq_puts(seq, ",discard=idle");
+
 	if (test_opt(sb, NOLOAD))
 		seq_puts(seq, ",norecovery");
 
@@ -1293,6 +1296,7 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_discard_idle,
 };
 
 static const match_table_t tokens = {
@@ -1365,6 +1369,7 @@ static const match_table_t tokens = {
 	{Opt_dioread_lock, "dioread_lock"},
 	{Opt_discard, "discard"},
 	{Opt_nodiscard, "nodiscard"},
+	{Opt_discard_idle, "discard=idle"},
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
@@ -1834,9 +1839,15 @@ set_qf_format:
 			break;
 		case Opt_discard:
 			set_opt(sb, DISCARD);
+			clear_opt2(sb, IDLE_DISCARD);
 			break;
 		case Opt_nodiscard:
 			clear_opt(sb, DISCARD);
+			clear_opt2(sb, IDLE_DISCARD);
+			break;
+		case Opt_discard_idle:
+			clear_opt(sb, DISCARD);
+			set_opt2(sb, IDLE_DISCARD);
 			break;
 		case Opt_dioread_nolock:
 			set_opt(sb, DIOREAD_NOLOCK);
@@ -2533,6 +2544,9 @@ EXT4_RW_ATTR_SBI_UI(mb_order2_req, s_mb_order2_reqs);
 EXT4_RW_ATTR_SBI_UI(mb_stream_req, s_mb_stream_request);
 EXT4_RW_ATTR_SBI_UI(mb_group_prealloc, s_mb_group_prealloc);
 EXT4_RW_ATTR_SBI_UI(max_writeback_mb_bump, s_max_writeback_mb_bump);
+EXT4_RW_ATTR_SBI_UI(idle_discard_ms, s_idle_discard_ms);
+EXT4_RW_ATTR_SBI_UI(idle_discard_batch, s_idle_discard_batch);
+EXT4_RW_ATTR_SBI_UI(idle_discard_max_ranges, s_idle_discard_max_ranges);
 
 static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(delayed_allocation_blocks),
@@ -2549,6 +2563,9 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(mb_stream_req),
 	ATTR_LIST(mb_group_prealloc),
 	ATTR_LIST(max_writeback_mb_bump),
+	ATTR_LIST(idle_discard_ms),
+	ATTR_LIST(idle_discard_batch),
+	ATTR_LIST(idle_discard_max_ranges),
 	NULL,
 };
 
@@ -4443,6 +4460,7 @@ static int ext4_remount(struct super_block *sb, int *flags, char *data)
 	}
 
 	ext4_setup_system_zone(sb);
+	ext4_idle_discard_update(sb);
 	if (sbi->s_journal == NULL && !(old_sb_flags & MS_RDONLY))
 		ext4_commit_super(sb, 1);
 
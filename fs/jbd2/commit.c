@@ -825,6 +825,19 @@ wait_for_iobuf:
 	if (err)
 		jbd2_journal_abort(journal, err);
 
+	/*
+	 * The commit record is on disk. Release fsync() and synchronous
+	 * handle waiters now instead of after the forget list processing
+	 * and the commit callback below, which can take a while on large
+	 * transactions or when the callback issues discards.
+	 */
+	if (!is_journal_aborted(journal)) {
+		write_lock(&journal->j_state_lock);
+		journal->j_durable_sequence = commit_transaction->t_tid;
+		write_unlock(&journal->j_state_lock);
+		wake_up(&journal->j_wait_done_commit);
+	}
+
 	/* End of a transaction!  Finally, we can do checkpoint
            processing: any buffers committed as a result of this
            transaction can be removed from any checkpoint list it was on
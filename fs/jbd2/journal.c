@@ -82,6 +82,7 @@ EXPORT_SYMBOL(jbd2_journal_errno);
 EXPORT_SYMBOL(jbd2_journal_ack_err);
 EXPORT_SYMBOL(jbd2_journal_clear_err);
 EXPORT_SYMBOL(jbd2_log_wait_commit);
+EXPORT_SYMBOL(jbd2_log_wait_durable);
 EXPORT_SYMBOL(jbd2_log_start_commit);
 EXPORT_SYMBOL(jbd2_journal_start_commit);
 EXPORT_SYMBOL(jbd2_journal_force_commit_nested);
@@ -662,6 +663,37 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Wait for the commit record of a specified transaction to reach stable
+ * storage. Unlike jbd2_log_wait_commit() this does not wait for the
+ * commit thread to finish filing the transaction's buffers for
+ * checkpointing, which is all that fsync() and synchronous handles need.
+ */
+int jbd2_log_wait_durable(journal_t *journal, tid_t tid)
+{
+	int err = 0;
+
+	read_lock(&journal->j_state_lock);
+	while (tid_gt(tid, journal->j_commit_sequence) &&
+	       tid_gt(tid, journal->j_durable_sequence)) {
+		jbd_debug(1, "JBD: want %d, j_durable_sequence=%d\n",
+				  tid, journal->j_durable_sequence);
+		wake_up(&journal->j_wait_commit);
+		read_unlock(&journal->j_state_lock);
+		wait_event(journal->j_wait_done_commit,
+			   !tid_gt(tid, journal->j_commit_sequence) ||
+			   !tid_gt(tid, journal->j_durable_sequence));
+		read_lock(&journal->j_state_lock);
+	}
+	read_unlock(&journal->j_state_lock);
+
+	if (unlikely(is_journal_aborted(journal))) {
+		printk(KERN_EMERG "journal commit I/O error\n");
+		err = -EIO;
+	}
+	return err;
+}
+
 /*
  * Log buffer allocation routines:
  */
@@ -1109,6 +1141,7 @@ static int journal_reset(journal_t *journal)
 	journal->j_tail_sequence = journal->j_transaction_sequence;
 	journal->j_commit_sequence = journal->j_transaction_sequence - 1;
 	journal->j_commit_request = journal->j_commit_sequence;
+	journal->j_durable_sequence = journal->j_commit_sequence;
 
 	journal->j_max_transaction_buffers = journal->j_maxlen / 4;
 
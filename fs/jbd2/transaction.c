@@ -1411,7 +1411,7 @@ int jbd2_journal_stop(handle_t *handle)
 	}
 
 	if (wait_for_commit)
-		err = jbd2_log_wait_commit(journal, tid);
+		err = jbd2_log_wait_durable(journal, tid);
 
 	lock_map_release(&handle->h_lockdep_map);
 
@@ -0,0 +1,10 @@
+#ifndef _LINUX_FLIGHT_RECORDER_H
+#define _LINUX_FLIGHT_RECORDER_H
+
+#ifdef CONFIG_FLIGHT_RECORDER
+extern void flight_recorder_freeze(const char *reason);
+#else
+static inline void flight_recorder_freeze(const char *reason) { }
+#endif
+
+#endif /* _LINUX_FLIGHT_RECORDER_H */
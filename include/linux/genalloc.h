@@ -27,7 +27,7 @@ gen_pool_alloc_aligned(struct gen_pool *pool, size_t size,
  * @size:	Number of bytes to allocate from the pool.
  *
  * Allocate the requested number of bytes from the specified pool.
- * Uses a first-fit algorithm.
+ * Uses a best-fit algorithm.
  */
 static inline unsigned long __must_check
 gen_pool_alloc(struct gen_pool *pool, size_t size)
@@ -37,6 +37,18 @@ gen_pool_alloc(struct gen_pool *pool, size_t size)
 
 void gen_pool_free(struct gen_pool *pool, unsigned long addr, size_t size);
 
+struct gen_pool_stats {
+	size_t size;			/* bytes managed by the pool */
+	size_t avail;			/* free bytes */
+	size_t largest;			/* largest free extent in bytes */
+	unsigned long nr_chunks;
+	unsigned long nr_unindexed;	/* chunks scanning their bitmap */
+	unsigned long nr_extents;	/* free extents */
+	unsigned long extents[BITS_PER_LONG]; /* free extents by log2 bytes */
+};
+
+void gen_pool_get_stats(struct gen_pool *pool, struct gen_pool_stats *stats);
+
 extern phys_addr_t gen_pool_virt_to_phys(struct gen_pool *pool, unsigned long);
 extern int gen_pool_add_virt(struct gen_pool *, unsigned long, phys_addr_t,
 			     size_t, int);
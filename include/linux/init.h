@@ -211,6 +211,28 @@ extern int initcall_debug;
 
 #define __initcall(fn) device_initcall(fn)
 
+/*
+ * Async device initcalls are handed to the async workers when their turn
+ * in the device level comes, and run concurrently with the remaining
+ * device initcalls. The _after variant waits for the named async device
+ * initcall @dep to complete first; an initcall that would close a
+ * dependency cycle is run synchronously instead, with a warning. All of
+ * them have finished before the first device_initcall_sync() runs.
+ */
+extern int initcall_schedule_async(initcall_t fn, const char *name,
+				   const char *dep);
+
+#define __define_async_initcall(fn, dep)				\
+	static int __init __async_initcall_##fn(void)			\
+	{								\
+		return initcall_schedule_async(fn, #fn, dep);		\
+	}								\
+	device_initcall(__async_initcall_##fn)
+
+#define device_initcall_async(fn)	__define_async_initcall(fn, NULL)
+#define device_initcall_async_after(fn, dep)				\
+	__define_async_initcall(fn, #dep)
+
 #define __exitcall(fn) \
 	static exitcall_t __exitcall_##fn __exit_call = fn
 
@@ -287,6 +309,8 @@ void __init parse_early_options(char *cmdline);
 #define subsys_initcall(fn)		module_init(fn)
 #define fs_initcall(fn)			module_init(fn)
 #define device_initcall(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define device_initcall_async_after(fn, dep)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
 
 #define security_initcall(fn)		module_init(fn)
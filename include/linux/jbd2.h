@@ -744,6 +744,8 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  *  transaction
  * @j_commit_request: Sequence number of the most recent transaction wanting
  *     commit
+ * @j_durable_sequence: Sequence number of the most recent transaction whose
+ *     commit record is on stable storage
  * @j_uuid: Uuid of client object.
  * @j_task: Pointer to the current commit thread for this journal
  * @j_max_transaction_buffers:  Maximum number of metadata buffers to allow in a
@@ -924,6 +926,14 @@ struct journal_s
 	 */
 	tid_t			j_commit_request;
 
+	/*
+	 * Sequence number of the most recent transaction whose commit record
+	 * has reached stable storage. Runs ahead of j_commit_sequence while
+	 * the commit thread files the transaction for checkpointing
+	 * [j_state_lock].
+	 */
+	tid_t			j_durable_sequence;
+
 	/*
 	 * Journal uuid: identifies the object (filesystem, LVM volume etc)
 	 * backed by this journal.  This will eventually be replaced by an array
@@ -1228,6 +1238,7 @@ int __jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
 int jbd2_journal_force_commit_nested(journal_t *journal);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
+int jbd2_log_wait_durable(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
@@ -65,6 +65,8 @@
 						struct msmfb_data)
 #define MSMFB_WRITEBACK_TERMINATE _IO(MSMFB_IOCTL_MAGIC, 155)
 #define MSMFB_MDP_PP _IOWR(MSMFB_IOCTL_MAGIC, 156, struct msmfb_mdp_pp)
+#define MSMFB_OVERLAY_COMMIT _IOWR(MSMFB_IOCTL_MAGIC, 157, \
+						struct msmfb_overlay_commit)
 
 #define FB_TYPE_3D_PANEL 0x10101010
 #define MDP_IMGTYPE2_START 0x10000
@@ -244,6 +246,23 @@ struct msmfb_overlay_data {
 	struct msmfb_data plane2_data;
 };
 
+#define MSMFB_OVERLAY_COMMIT_MAX	4
+
+/*
+ * Stage up to MSMFB_OVERLAY_COMMIT_MAX pipes of the same mixer and kick
+ * them off as one frame.  The ioctl returns once the frame is queued;
+ * release_fence_fd signals when the buffers of this commit are no longer
+ * scanned out, i.e. once the next commit reaches the screen or the panel
+ * is blanked.  It is -1 if the kernel has no sync support.
+ */
+struct msmfb_overlay_commit {
+	uint32_t flags;			/* reserved, must be 0 */
+	uint32_t num_pipes;
+	struct msmfb_overlay_data data[MSMFB_OVERLAY_COMMIT_MAX];
+	int release_fence_fd;		/* out */
+	uint32_t frame;			/* out, commit sequence number */
+};
+
 struct msmfb_img {
 	uint32_t width;
 	uint32_t height;
@@ -434,6 +434,8 @@ struct dev_pm_info {
 	struct list_head	entry;
 	struct completion	completion;
 	struct wakeup_source	*wakeup;
+	s64			suspend_time_us; /* last system suspend */
+	s64			resume_time_us;	/* last system resume */
 #else
 	unsigned int		should_wakeup:1;
 #endif
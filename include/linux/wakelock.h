@@ -49,6 +49,8 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		int             contended_count;
+		ktime_t         contended_time;
 	} stat;
 #endif
 };
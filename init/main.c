@@ -69,6 +69,8 @@
 #include <linux/slab.h>
 #include <linux/perf_event.h>
 #include <linux/random.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -660,7 +662,44 @@ static void __init do_ctors(void)
 int initcall_debug;
 core_param(initcall_debug, initcall_debug, bool, 0644);
 
-static char msgbuf[64];
+/*
+ * initcall_chart records when each boot time initcall started and ended
+ * and on which task, so that concurrent async initcalls can be laid out
+ * on a timeline from debugfs.
+ */
+static bool initcall_chart;
+core_param(initcall_chart, initcall_chart, bool, 0444);
+
+struct initcall_chart_entry {
+	struct list_head	list;
+	initcall_t		fn;
+	s64			start_us;
+	s64			end_us;
+	pid_t			pid;
+	int			ret;
+};
+
+static LIST_HEAD(initcall_chart_list);
+static DEFINE_MUTEX(initcall_chart_mutex);
+
+static void __init_or_module initcall_chart_add(initcall_t fn, ktime_t start,
+						ktime_t end, int ret)
+{
+	struct initcall_chart_entry *e;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return;
+	e->fn = fn;
+	e->start_us = ktime_to_us(start);
+	e->end_us = ktime_to_us(end);
+	e->pid = task_pid_nr(current);
+	e->ret = ret;
+
+	mutex_lock(&initcall_chart_mutex);
+	list_add_tail(&e->list, &initcall_chart_list);
+	mutex_unlock(&initcall_chart_mutex);
+}
 
 static int __init_or_module do_one_initcall_debug(initcall_t fn)
 {
@@ -683,13 +722,21 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	ktime_t calltime = ktime_set(0, 0);
+	char msgbuf[64];
 	int ret;
 
+	if (initcall_chart && system_state == SYSTEM_BOOTING)
+		calltime = ktime_get();
+
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
 
+	if (initcall_chart && system_state == SYSTEM_BOOTING)
+		initcall_chart_add(fn, calltime, ktime_get(), ret);
+
 	msgbuf[0] = 0;
 
 	if (ret && ret != -ENODEV && initcall_debug)
@@ -711,6 +758,215 @@ int __init_or_module do_one_initcall(initcall_t fn)
 }
 
 
+/*
+ * Async device initcalls, see device_initcall_async(). Each one is run
+ * from an async worker once the initcall it depends on, if any, is done.
+ * initcall_async=0 on the command line runs them inline instead.
+ */
+struct initcall_async {
+	struct list_head	list;
+	initcall_t		fn;
+	const char		*name;
+	const char		*dep;
+	bool			done;
+};
+
+static bool initcall_async = true;
+core_param(initcall_async, initcall_async, bool, 0444);
+
+static __initdata LIST_HEAD(initcall_async_list);
+static __initdata LIST_HEAD(initcall_async_domain);
+static __initdata DEFINE_SPINLOCK(initcall_async_lock);
+static __initdata DECLARE_WAIT_QUEUE_HEAD(initcall_async_wq);
+static bool __initdata initcall_async_closed;
+
+/* Called with initcall_async_lock held */
+static struct initcall_async * __init initcall_async_find(const char *name)
+{
+	struct initcall_async *d;
+
+	list_for_each_entry(d, &initcall_async_list, list)
+		if (!strcmp(d->name, name))
+			return d;
+	return NULL;
+}
+
+/*
+ * A dependency is satisfied once the named initcall has completed, or
+ * once no more async initcalls can be registered and it never was.
+ */
+static bool __init initcall_async_dep_done(struct initcall_async *a)
+{
+	struct initcall_async *d;
+	bool done;
+
+	spin_lock(&initcall_async_lock);
+	d = initcall_async_find(a->dep);
+	done = d ? d->done : initcall_async_closed;
+	spin_unlock(&initcall_async_lock);
+
+	return done;
+}
+
+/*
+ * Called with initcall_async_lock held, after @a has been added. Cycles
+ * are broken as they close, so following the chain from @a ends unless
+ * it comes back to @a.
+ */
+static bool __init initcall_async_cycle(struct initcall_async *a)
+{
+	struct initcall_async *d = a;
+
+	while (d->dep && (d = initcall_async_find(d->dep)))
+		if (d == a)
+			return true;
+	return false;
+}
+
+static void __init initcall_async_run(void *data, async_cookie_t cookie)
+{
+	struct initcall_async *a = data;
+	bool missing;
+
+	if (a->dep) {
+		wait_event(initcall_async_wq, initcall_async_dep_done(a));
+
+		spin_lock(&initcall_async_lock);
+		missing = !initcall_async_find(a->dep);
+		spin_unlock(&initcall_async_lock);
+		if (missing)
+			pr_warning("initcall %s: dependency %s is not an async "
+				   "device initcall\n", a->name, a->dep);
+	}
+
+	do_one_initcall(a->fn);
+
+	spin_lock(&initcall_async_lock);
+	a->done = true;
+	spin_unlock(&initcall_async_lock);
+	wake_up_all(&initcall_async_wq);
+}
+
+int __init initcall_schedule_async(initcall_t fn, const char *name,
+				   const char *dep)
+{
+	struct initcall_async *a;
+	bool cycle;
+
+	if (!initcall_async || initcall_async_closed)
+		return fn();
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return fn();
+	a->fn = fn;
+	a->name = name;
+	a->dep = dep;
+
+	spin_lock(&initcall_async_lock);
+	list_add_tail(&a->list, &initcall_async_list);
+	cycle = initcall_async_cycle(a);
+	if (cycle)
+		a->dep = NULL;
+	spin_unlock(&initcall_async_lock);
+
+	/*
+	 * The rest of the cycle is already waiting on @a, so run it here
+	 * without waiting for its own dependency; that releases the others.
+	 */
+	if (cycle) {
+		WARN(1, "initcall %s: dependency cycle through %s, "
+		     "running it synchronously\n", name, dep);
+		initcall_async_run(a, 0);
+		return 0;
+	}
+
+	async_schedule_domain(initcall_async_run, a, &initcall_async_domain);
+	return 0;
+}
+
+/*
+ * Wait for every async device initcall. init/ is linked first, so this
+ * runs ahead of all other device_initcall_sync()s.
+ */
+static int __init initcall_async_barrier(void)
+{
+	struct initcall_async *a, *tmp;
+
+	spin_lock(&initcall_async_lock);
+	initcall_async_closed = true;
+	spin_unlock(&initcall_async_lock);
+	wake_up_all(&initcall_async_wq);
+
+	async_synchronize_full_domain(&initcall_async_domain);
+
+	list_for_each_entry_safe(a, tmp, &initcall_async_list, list) {
+		list_del(&a->list);
+		kfree(a);
+	}
+	return 0;
+}
+device_initcall_sync(initcall_async_barrier);
+
+#ifdef CONFIG_DEBUG_FS
+static void *initcall_chart_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&initcall_chart_mutex);
+	if (!*pos)
+		seq_puts(m, "# start_us   end_us   dur_us    pid  ret  initcall\n");
+	return seq_list_start(&initcall_chart_list, *pos);
+}
+
+static void *initcall_chart_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	return seq_list_next(v, &initcall_chart_list, pos);
+}
+
+static void initcall_chart_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&initcall_chart_mutex);
+}
+
+static int initcall_chart_show(struct seq_file *m, void *v)
+{
+	struct initcall_chart_entry *e =
+		list_entry(v, struct initcall_chart_entry, list);
+
+	seq_printf(m, "%9lld %9lld %8lld %6d %4d  %pF\n",
+		   e->start_us, e->end_us, e->end_us - e->start_us,
+		   e->pid, e->ret, e->fn);
+	return 0;
+}
+
+static const struct seq_operations initcall_chart_seq_ops = {
+	.start	= initcall_chart_start,
+	.next	= initcall_chart_next,
+	.stop	= initcall_chart_stop,
+	.show	= initcall_chart_show,
+};
+
+static int initcall_chart_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &initcall_chart_seq_ops);
+}
+
+static const struct file_operations initcall_chart_fops = {
+	.open		= initcall_chart_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init initcall_chart_debugfs_init(void)
+{
+	if (initcall_chart)
+		debugfs_create_file("initcall_chart", S_IRUGO, NULL, NULL,
+				    &initcall_chart_fops);
+	return 0;
+}
+late_initcall(initcall_chart_debugfs_init);
+#endif
+
 extern initcall_t __initcall_start[], __initcall_end[], __early_initcall_end[];
 
 static void __init do_initcalls(void)
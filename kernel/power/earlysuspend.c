@@ -13,10 +13,14 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
 
@@ -35,6 +39,9 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static int debug_earlysuspend_level = 500;
 module_param_named(earlysuspend_level, debug_earlysuspend_level, int, S_IRUGO | S_IWUSR | S_IWGRP);
 #endif
+static int async_handlers = 1;
+module_param_named(async_handlers, async_handlers, int,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
 static void early_suspend(struct work_struct *work);
@@ -48,6 +55,7 @@ enum {
 	SUSPEND_REQUESTED_AND_SUSPENDED = SUSPEND_REQUESTED | SUSPENDED,
 };
 static int state;
+static LIST_HEAD(early_suspend_domain);
 
 void register_early_suspend(struct early_suspend *handler)
 {
@@ -82,11 +90,67 @@ EXPORT_SYMBOL(unregister_early_suspend);
 #ifdef CONFIG_ZTE_PLATFORM_LCD_ON_TIME
 extern void zte_update_lateresume_2_earlysuspend_time(bool resume_or_earlysuspend);	//LHX_PM_20110411_01 resume_or_earlysuspend? lateresume : earlysuspend
 #endif
+
+static void early_suspend_call(struct early_suspend *h, bool resume)
+{
+	ktime_t start = ktime_get();
+	s64 delta;
+
+	if (resume)
+		h->resume(h);
+	else
+		h->suspend(h);
+
+	delta = ktime_us_delta(ktime_get(), start);
+	if (resume)
+		h->resume_us = delta;
+	else
+		h->suspend_us = delta;
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: %pf took %lld us\n",
+			resume ? "late_resume" : "early_suspend",
+			resume ? (void *)h->resume : (void *)h->suspend,
+			delta);
+}
+
+static void early_suspend_async(void *data, async_cookie_t cookie)
+{
+	early_suspend_call(data, false);
+}
+
+static void late_resume_async(void *data, async_cookie_t cookie)
+{
+	early_suspend_call(data, true);
+}
+
+/*
+ * Run one handler hook. Handlers marked async are started on the early
+ * suspend async domain and only waited for when the level changes, so
+ * independent handlers of the same level overlap.
+ */
+static void early_suspend_run(struct early_suspend *h, bool resume,
+			      int *level)
+{
+	if (h->level != *level) {
+		async_synchronize_full_domain(&early_suspend_domain);
+		*level = h->level;
+	}
+
+	if (async_handlers && h->async)
+		async_schedule_domain(resume ? late_resume_async :
+				      early_suspend_async, h,
+				      &early_suspend_domain);
+	else
+		early_suspend_call(h, resume);
+}
+
 static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -117,9 +181,10 @@ static void early_suspend(struct work_struct *work)
 			#endif
 			if (debug_mask & DEBUG_SUSPEND)
 				pr_info("early_suspend: handlers level=%d, calling %pf\n", pos->level, pos->suspend);
-			pos->suspend(pos);
+			early_suspend_run(pos, false, &level);
 		}
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -140,6 +205,7 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -163,9 +229,10 @@ static void late_resume(struct work_struct *work)
 			if (debug_mask & DEBUG_SUSPEND)
 				pr_info("late_resume: handlers level=%d, calling %pf\n", pos->level, pos->resume);
 
-			pos->resume(pos);
+			early_suspend_run(pos, true, &level);
 		}
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 #ifdef CONFIG_ZTE_PLATFORM_LCD_ON_TIME
@@ -213,3 +280,39 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+static int early_suspend_timing_show(struct seq_file *s, void *data)
+{
+	struct early_suspend *pos;
+
+	seq_printf(s, "level  async  suspend_us  resume_us  handler\n");
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(s, "%5d  %5d  %10lld  %9lld  %pf\n",
+			   pos->level, pos->async, pos->suspend_us,
+			   pos->resume_us,
+			   pos->suspend ? (void *)pos->suspend :
+					  (void *)pos->resume);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_timing_show, NULL);
+}
+
+static const struct file_operations early_suspend_timing_fops = {
+	.open		= early_suspend_timing_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_timing_init(void)
+{
+	debugfs_create_file("early_suspend_timing", S_IRUGO, NULL, NULL,
+			    &early_suspend_timing_fops);
+	return 0;
+}
+late_initcall(early_suspend_timing_init);
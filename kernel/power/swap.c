@@ -26,6 +26,11 @@
 #include <linux/slab.h>
 #include <linux/lzo.h>
 #include <linux/vmalloc.h>
+#include <linux/cpumask.h>
+#include <linux/atomic.h>
+#include <linux/kthread.h>
+#include <linux/crc32.h>
+#include <linux/ktime.h>
 
 #include "power.h"
 
@@ -63,10 +68,13 @@ struct swap_map_handle {
 	sector_t cur_swap;
 	sector_t first_sector;
 	unsigned int k;
+	u32 crc32;
 };
 
 struct swsusp_header {
-	char reserved[PAGE_SIZE - 20 - sizeof(sector_t) - sizeof(int)];
+	char reserved[PAGE_SIZE - 20 - sizeof(sector_t) - sizeof(int) -
+		      sizeof(u32)];
+	u32	crc32;
 	sector_t image;
 	unsigned int flags;	/* Flags to pass to the "boot" kernel */
 	char	orig_sig[10];
@@ -198,6 +206,8 @@ static int mark_swapfiles(struct swap_map_handle *handle, unsigned int flags)
 		memcpy(swsusp_header->sig, HIBERNATE_SIG, 10);
 		swsusp_header->image = handle->first_sector;
 		swsusp_header->flags = flags;
+		if (flags & SF_CRC32_MODE)
+			swsusp_header->crc32 = handle->crc32;
 		error = hib_bio_write_page(swsusp_resume_block,
 					swsusp_header, NULL);
 	} else {
@@ -371,6 +381,247 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
+/* Maximum number of threads for compression/decompression. */
+#define LZO_THREADS	3
+
+static inline void hib_account(s64 *acc, ktime_t *t)
+{
+	ktime_t now = ktime_get();
+
+	*acc += ktime_us_delta(now, *t);
+	*t = now;
+}
+
+/*
+ * Structure used for CRC32 of the uncompressed image data. It runs over
+ * the buffers of the last batch while the main thread writes (or copies
+ * out) the same data.
+ */
+struct crc_data {
+	struct task_struct *thr;		/* thread */
+	atomic_t ready;				/* ready to start flag */
+	atomic_t stop;				/* ready to stop flag */
+	unsigned run_threads;			/* nr current threads */
+	wait_queue_head_t go;			/* start crc update */
+	wait_queue_head_t done;			/* crc update done */
+	u32 *crc32;				/* points to handle's crc32 */
+	size_t *unc_len[LZO_THREADS];		/* uncompressed lengths */
+	unsigned char *unc[LZO_THREADS];	/* uncompressed data */
+};
+
+static int crc32_threadfn(void *data)
+{
+	struct crc_data *d = data;
+	unsigned i;
+
+	while (1) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (kthread_should_stop()) {
+			d->thr = NULL;
+			atomic_set(&d->stop, 1);
+			wake_up(&d->done);
+			break;
+		}
+		atomic_set(&d->ready, 0);
+
+		for (i = 0; i < d->run_threads; i++)
+			*d->crc32 = crc32_le(*d->crc32,
+					     d->unc[i], *d->unc_len[i]);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+static void crc32_start(struct crc_data *crc, unsigned run_threads)
+{
+	crc->run_threads = run_threads;
+	atomic_set(&crc->ready, 1);
+	wake_up(&crc->go);
+}
+
+static void crc32_wait(struct crc_data *crc)
+{
+	wait_event(crc->done, atomic_read(&crc->stop));
+	atomic_set(&crc->stop, 0);
+}
+
+/*
+ * Structure used for LZO data compression and decompression, one per
+ * thread. Each thread works on one LZO_UNC_SIZE chunk at a time.
+ */
+struct lzo_data {
+	struct task_struct *thr;		/* thread */
+	atomic_t ready;				/* ready to start flag */
+	atomic_t stop;				/* ready to stop flag */
+	int ret;				/* return code */
+	wait_queue_head_t go;			/* start (de)compression */
+	wait_queue_head_t done;			/* (de)compression done */
+	size_t unc_len;				/* uncompressed length */
+	size_t cmp_len;				/* compressed length */
+	unsigned char unc[LZO_UNC_SIZE];	/* uncompressed buffer */
+	unsigned char cmp[LZO_CMP_SIZE];	/* compressed buffer */
+	unsigned char wrk[LZO1X_1_MEM_COMPRESS]; /* compression workspace */
+};
+
+static int lzo_compress_threadfn(void *data)
+{
+	struct lzo_data *d = data;
+
+	while (1) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (kthread_should_stop()) {
+			d->thr = NULL;
+			d->ret = -1;
+			atomic_set(&d->stop, 1);
+			wake_up(&d->done);
+			break;
+		}
+		atomic_set(&d->ready, 0);
+
+		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
+					  d->cmp + LZO_HEADER, &d->cmp_len,
+					  d->wrk);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+static int lzo_decompress_threadfn(void *data)
+{
+	struct lzo_data *d = data;
+
+	while (1) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (kthread_should_stop()) {
+			d->thr = NULL;
+			d->ret = -1;
+			atomic_set(&d->stop, 1);
+			wake_up(&d->done);
+			break;
+		}
+		atomic_set(&d->ready, 0);
+
+		d->unc_len = LZO_UNC_SIZE;
+		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
+					       d->unc, &d->unc_len);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+static void lzo_start(struct lzo_data *d)
+{
+	atomic_set(&d->ready, 1);
+	wake_up(&d->go);
+}
+
+static void lzo_wait(struct lzo_data *d)
+{
+	wait_event(d->done, atomic_read(&d->stop));
+	atomic_set(&d->stop, 0);
+}
+
+/**
+ * lzo_threads_start - Allocate per-thread LZO buffers and start the threads.
+ * @nr_threads: Number of (de)compression threads.
+ * @threadfn: Compression or decompression thread function.
+ * @crc32: Where the CRC thread accumulates its result.
+ * @crcp: Returns the CRC thread data.
+ *
+ * Returns the thread data array or NULL; on failure everything that was
+ * set up is torn down again.
+ */
+static struct lzo_data *lzo_threads_start(unsigned nr_threads,
+					  int (*threadfn)(void *),
+					  u32 *crc32, struct crc_data **crcp)
+{
+	struct lzo_data *data;
+	struct crc_data *crc;
+	unsigned thr;
+
+	data = vmalloc(sizeof(*data) * nr_threads);
+	if (!data) {
+		printk(KERN_ERR "PM: Failed to allocate LZO data\n");
+		return NULL;
+	}
+	for (thr = 0; thr < nr_threads; thr++)
+		memset(&data[thr], 0, offsetof(struct lzo_data, unc));
+
+	crc = kzalloc(sizeof(*crc), GFP_KERNEL);
+	if (!crc) {
+		printk(KERN_ERR "PM: Failed to allocate crc\n");
+		vfree(data);
+		return NULL;
+	}
+
+	for (thr = 0; thr < nr_threads; thr++) {
+		init_waitqueue_head(&data[thr].go);
+		init_waitqueue_head(&data[thr].done);
+
+		data[thr].thr = kthread_run(threadfn, &data[thr],
+					    threadfn == lzo_compress_threadfn ?
+					    "image_compress/%u" :
+					    "image_decompress/%u", thr);
+		if (IS_ERR(data[thr].thr)) {
+			data[thr].thr = NULL;
+			printk(KERN_ERR "PM: Cannot start LZO threads\n");
+			goto err;
+		}
+
+		crc->unc[thr] = data[thr].unc;
+		crc->unc_len[thr] = &data[thr].unc_len;
+	}
+
+	init_waitqueue_head(&crc->go);
+	init_waitqueue_head(&crc->done);
+	*crc32 = 0;
+	crc->crc32 = crc32;
+	crc->thr = kthread_run(crc32_threadfn, crc, "image_crc32");
+	if (IS_ERR(crc->thr)) {
+		crc->thr = NULL;
+		printk(KERN_ERR "PM: Cannot start CRC32 thread\n");
+		goto err;
+	}
+
+	*crcp = crc;
+	return data;
+
+err:
+	for (thr = 0; thr < nr_threads; thr++)
+		if (data[thr].thr)
+			kthread_stop(data[thr].thr);
+	kfree(crc);
+	vfree(data);
+	return NULL;
+}
+
+static void lzo_threads_stop(struct lzo_data *data, unsigned nr_threads,
+			     struct crc_data *crc)
+{
+	unsigned thr;
+
+	if (crc->thr)
+		kthread_stop(crc->thr);
+	kfree(crc);
+
+	for (thr = 0; thr < nr_threads; thr++)
+		if (data[thr].thr)
+			kthread_stop(data[thr].thr);
+	vfree(data);
+}
+
+static unsigned lzo_nr_threads(void)
+{
+	/* Leave one CPU to the main thread doing the I/O */
+	return clamp_val(num_online_cpus() - 1, 1, LZO_THREADS);
+}
+
 /**
  *	save_image - save the suspend image data
  */
@@ -424,6 +675,10 @@ static int save_image(struct swap_map_handle *handle,
  * @handle: Swap mam handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ *
+ * Up to LZO_THREADS chunks are compressed in parallel while a separate
+ * thread computes the CRC32 of the uncompressed data; the main thread
+ * gathers the pages and queues the compressed data for writing.
  */
 static int save_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
@@ -436,8 +691,15 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	struct bio *bio;
 	struct timeval start;
 	struct timeval stop;
-	size_t off, unc_len, cmp_len;
-	unsigned char *unc, *cmp, *wrk, *page;
+	size_t off;
+	unsigned thr, run_threads, nr_threads;
+	unsigned char *page;
+	struct lzo_data *data;
+	struct crc_data *crc = NULL;
+	s64 t_copy = 0, t_cmp = 0, t_write = 0, t_crc = 0, t_io = 0;
+	ktime_t t;
+
+	nr_threads = lzo_nr_threads();
 
 	page = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
 	if (!page) {
@@ -445,93 +707,110 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		return -ENOMEM;
 	}
 
-	wrk = vmalloc(LZO1X_1_MEM_COMPRESS);
-	if (!wrk) {
-		printk(KERN_ERR "PM: Failed to allocate LZO workspace\n");
-		free_page((unsigned long)page);
-		return -ENOMEM;
-	}
-
-	unc = vmalloc(LZO_UNC_SIZE);
-	if (!unc) {
-		printk(KERN_ERR "PM: Failed to allocate LZO uncompressed\n");
-		vfree(wrk);
-		free_page((unsigned long)page);
-		return -ENOMEM;
-	}
-
-	cmp = vmalloc(LZO_CMP_SIZE);
-	if (!cmp) {
-		printk(KERN_ERR "PM: Failed to allocate LZO compressed\n");
-		vfree(unc);
-		vfree(wrk);
+	data = lzo_threads_start(nr_threads, lzo_compress_threadfn,
+				 &handle->crc32, &crc);
+	if (!data) {
 		free_page((unsigned long)page);
 		return -ENOMEM;
 	}
 
 	printk(KERN_INFO
+		"PM: Using %u thread(s) for compression.\n"
 		"PM: Compressing and saving image data (%u pages) ...     ",
-		nr_to_write);
+		nr_threads, nr_to_write);
 	m = nr_to_write / 100;
 	if (!m)
 		m = 1;
 	nr_pages = 0;
 	bio = NULL;
 	do_gettimeofday(&start);
+	t = ktime_get();
 	for (;;) {
-		for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
-			ret = snapshot_read_next(snapshot);
-			if (ret < 0)
-				goto out_finish;
-
-			if (!ret)
+		for (thr = 0; thr < nr_threads; thr++) {
+			for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
+				ret = snapshot_read_next(snapshot);
+				if (ret < 0)
+					goto out_finish;
+
+				if (!ret)
+					break;
+
+				memcpy(data[thr].unc + off,
+				       data_of(*snapshot), PAGE_SIZE);
+
+				if (!(nr_pages % m))
+					printk(KERN_CONT "\b\b\b\b%3d%%",
+					       nr_pages / m);
+				nr_pages++;
+			}
+			if (!off)
 				break;
 
-			memcpy(unc + off, data_of(*snapshot), PAGE_SIZE);
-
-			if (!(nr_pages % m))
-				printk(KERN_CONT "\b\b\b\b%3d%%", nr_pages / m);
-			nr_pages++;
+			data[thr].unc_len = off;
+			lzo_start(&data[thr]);
 		}
 
-		if (!off)
+		if (!thr)
 			break;
+		hib_account(&t_copy, &t);
 
-		unc_len = off;
-		ret = lzo1x_1_compress(unc, unc_len,
-		                       cmp + LZO_HEADER, &cmp_len, wrk);
-		if (ret < 0) {
-			printk(KERN_ERR "PM: LZO compression failed\n");
-			break;
-		}
+		crc32_start(crc, thr);
 
-		if (unlikely(!cmp_len ||
-		             cmp_len > lzo1x_worst_compress(unc_len))) {
-			printk(KERN_ERR "PM: Invalid LZO compressed length\n");
-			ret = -1;
-			break;
-		}
+		for (run_threads = thr, thr = 0; thr < run_threads; thr++) {
+			lzo_wait(&data[thr]);
+			hib_account(&t_cmp, &t);
 
-		*(size_t *)cmp = cmp_len;
+			ret = data[thr].ret;
+			if (ret < 0) {
+				printk(KERN_ERR "PM: LZO compression failed\n");
+				break;
+			}
 
-		/*
-		 * Given we are writing one page at a time to disk, we copy
-		 * that much from the buffer, although the last bit will likely
-		 * be smaller than full page. This is OK - we saved the length
-		 * of the compressed data, so any garbage at the end will be
-		 * discarded when we read it.
-		 */
-		for (off = 0; off < LZO_HEADER + cmp_len; off += PAGE_SIZE) {
-			memcpy(page, cmp + off, PAGE_SIZE);
+			if (unlikely(!data[thr].cmp_len ||
+				     data[thr].cmp_len >
+				     lzo1x_worst_compress(data[thr].unc_len))) {
+				printk(KERN_ERR
+				       "PM: Invalid LZO compressed length\n");
+				ret = -1;
+				break;
+			}
 
-			ret = swap_write_page(handle, page, &bio);
+			*(size_t *)data[thr].cmp = data[thr].cmp_len;
+
+			/*
+			 * Given we are writing one page at a time to disk, we
+			 * copy that much from the buffer, although the last
+			 * bit will likely be smaller than full page. This is
+			 * OK - we saved the length of the compressed data, so
+			 * any garbage at the end will be discarded when we
+			 * read it.
+			 */
+			for (off = 0;
+			     off < LZO_HEADER + data[thr].cmp_len;
+			     off += PAGE_SIZE) {
+				memcpy(page, data[thr].cmp + off, PAGE_SIZE);
+
+				ret = swap_write_page(handle, page, &bio);
+				if (ret)
+					break;
+			}
+			hib_account(&t_write, &t);
 			if (ret)
-				goto out_finish;
+				break;
 		}
+
+		/* the next batch reuses the buffers the CRC is reading */
+		crc32_wait(crc);
+		hib_account(&t_crc, &t);
+
+		if (ret)
+			break;
 	}
 
 out_finish:
+	/* compression threads still busy on error are reaped by stop */
 	err2 = hib_wait_on_bio_chain(&bio);
+	hib_account(&t_io, &t);
 	do_gettimeofday(&stop);
 	if (!ret)
 		ret = err2;
@@ -540,10 +819,13 @@ out_finish:
 	else
 		printk(KERN_CONT "\n");
 	swsusp_show_speed(&start, &stop, nr_to_write, "Wrote");
+	printk(KERN_INFO "PM: save: copy %lld ms, compress %lld ms, "
+	       "write %lld ms, crc32 %lld ms, io %lld ms\n",
+	       div_s64(t_copy, 1000), div_s64(t_cmp, 1000),
+	       div_s64(t_write, 1000), div_s64(t_crc, 1000),
+	       div_s64(t_io, 1000));
 
-	vfree(cmp);
-	vfree(unc);
-	vfree(wrk);
+	lzo_threads_stop(data, nr_threads, crc);
 	free_page((unsigned long)page);
 
 	return ret;
@@ -605,6 +887,8 @@ int swsusp_write(unsigned int flags)
 
 		goto out_finish;
 	}
+	if (!(flags & SF_NOCOMPRESS_MODE))
+		flags |= SF_CRC32_MODE;
 	header = (struct swsusp_info *)data_of(snapshot);
 	error = swap_write_page(&handle, header, NULL);
 	if (!error) {
@@ -741,11 +1025,51 @@ static int load_image(struct swap_map_handle *handle,
 	return error;
 }
 
+/**
+ * lzo_read_chunk - Queue reads for one compressed chunk.
+ * @handle: Swap map handle to read from.
+ * @page: LZO_CMP_PAGES pages to read the chunk into.
+ * @cmp_len: Returns the compressed length from the chunk header.
+ * @bio_chain: Chain for the reads of all but the first page.
+ *
+ * The first page is read synchronously since it holds the length.
+ */
+static int lzo_read_chunk(struct swap_map_handle *handle,
+			  unsigned char **page, size_t *cmp_len,
+			  struct bio **bio_chain)
+{
+	size_t off;
+	int i, error;
+
+	error = swap_read_page(handle, page[0], NULL);
+	if (error)
+		return error;
+
+	*cmp_len = *(size_t *)page[0];
+	if (unlikely(!*cmp_len ||
+		     *cmp_len > lzo1x_worst_compress(LZO_UNC_SIZE))) {
+		printk(KERN_ERR "PM: Invalid LZO compressed length\n");
+		return -1;
+	}
+
+	for (off = PAGE_SIZE, i = 1;
+	     off < LZO_HEADER + *cmp_len; off += PAGE_SIZE, i++) {
+		error = swap_read_page(handle, page[i], bio_chain);
+		if (error)
+			return error;
+	}
+	return 0;
+}
+
 /**
  * load_image_lzo - Load compressed image data and decompress them with LZO.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ *
+ * Chunks are decompressed LZO_THREADS at a time. While a batch is being
+ * decompressed the reads for the next one are already in flight, and the
+ * CRC32 of the decompressed data is computed while it is copied out.
  */
 static int load_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
@@ -753,133 +1077,181 @@ static int load_image_lzo(struct swap_map_handle *handle,
 {
 	unsigned int m;
 	int error = 0;
+	int err2;
 	struct bio *bio;
 	struct timeval start;
 	struct timeval stop;
-	unsigned nr_pages;
-	size_t i, off, unc_len, cmp_len;
-	unsigned char *unc, *cmp, *page[LZO_CMP_PAGES];
-
-	for (i = 0; i < LZO_CMP_PAGES; i++) {
-		page[i] = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
-		if (!page[i]) {
-			printk(KERN_ERR "PM: Failed to allocate LZO page\n");
-
-			while (i)
-				free_page((unsigned long)page[--i]);
-
-			return -ENOMEM;
+	unsigned nr_pages, chunks;
+	size_t i, off;
+	unsigned thr, batch, next, nr_threads;
+	unsigned char *page[LZO_THREADS][LZO_CMP_PAGES];
+	size_t cmp_len[LZO_THREADS];
+	struct lzo_data *data;
+	struct crc_data *crc = NULL;
+	s64 t_read = 0, t_io = 0, t_dec = 0, t_copy = 0, t_crc = 0;
+	ktime_t t;
+
+	nr_threads = lzo_nr_threads();
+
+	memset(page, 0, sizeof(page));
+	for (thr = 0; thr < nr_threads; thr++) {
+		for (i = 0; i < LZO_CMP_PAGES; i++) {
+			page[thr][i] = (void *)__get_free_page(__GFP_WAIT |
+							       __GFP_HIGH);
+			if (!page[thr][i]) {
+				printk(KERN_ERR
+				       "PM: Failed to allocate LZO page\n");
+				error = -ENOMEM;
+				goto out_pages;
+			}
 		}
 	}
 
-	unc = vmalloc(LZO_UNC_SIZE);
-	if (!unc) {
-		printk(KERN_ERR "PM: Failed to allocate LZO uncompressed\n");
-
-		for (i = 0; i < LZO_CMP_PAGES; i++)
-			free_page((unsigned long)page[i]);
-
-		return -ENOMEM;
-	}
-
-	cmp = vmalloc(LZO_CMP_SIZE);
-	if (!cmp) {
-		printk(KERN_ERR "PM: Failed to allocate LZO compressed\n");
-
-		vfree(unc);
-		for (i = 0; i < LZO_CMP_PAGES; i++)
-			free_page((unsigned long)page[i]);
-
-		return -ENOMEM;
+	data = lzo_threads_start(nr_threads, lzo_decompress_threadfn,
+				 &handle->crc32, &crc);
+	if (!data) {
+		error = -ENOMEM;
+		goto out_pages;
 	}
 
 	printk(KERN_INFO
+		"PM: Using %u thread(s) for decompression.\n"
 		"PM: Loading and decompressing image data (%u pages) ...     ",
-		nr_to_read);
+		nr_threads, nr_to_read);
 	m = nr_to_read / 100;
 	if (!m)
 		m = 1;
 	nr_pages = 0;
 	bio = NULL;
 	do_gettimeofday(&start);
+	t = ktime_get();
+
+	/* every chunk but the last one holds LZO_UNC_PAGES pages */
+	chunks = DIV_ROUND_UP(nr_to_read, LZO_UNC_PAGES);
 
 	error = snapshot_write_next(snapshot);
 	if (error <= 0)
 		goto out_finish;
 
-	for (;;) {
-		error = swap_read_page(handle, page[0], NULL); /* sync */
+	batch = min(nr_threads, chunks);
+	for (thr = 0; thr < batch; thr++) {
+		error = lzo_read_chunk(handle, page[thr], &cmp_len[thr], &bio);
 		if (error)
-			break;
+			goto out_finish;
+	}
+	chunks -= batch;
+	hib_account(&t_read, &t);
 
-		cmp_len = *(size_t *)page[0];
-		if (unlikely(!cmp_len ||
-		             cmp_len > lzo1x_worst_compress(LZO_UNC_SIZE))) {
-			printk(KERN_ERR "PM: Invalid LZO compressed length\n");
-			error = -1;
-			break;
+	while (batch) {
+		error = hib_wait_on_bio_chain(&bio); /* need all data now */
+		if (error)
+			goto out_finish;
+		hib_account(&t_io, &t);
+
+		for (thr = 0; thr < batch; thr++) {
+			for (off = 0, i = 0;
+			     off < LZO_HEADER + cmp_len[thr];
+			     off += PAGE_SIZE, i++)
+				memcpy(data[thr].cmp + off, page[thr][i],
+				       PAGE_SIZE);
+			data[thr].cmp_len = cmp_len[thr];
+			lzo_start(&data[thr]);
 		}
 
-		for (off = PAGE_SIZE, i = 1;
-		     off < LZO_HEADER + cmp_len; off += PAGE_SIZE, i++) {
-			error = swap_read_page(handle, page[i], &bio);
+		/* Read ahead the next batch while this one decompresses */
+		next = min(nr_threads, chunks);
+		for (thr = 0; thr < next; thr++) {
+			error = lzo_read_chunk(handle, page[thr],
+					       &cmp_len[thr], &bio);
 			if (error)
 				goto out_finish;
 		}
+		chunks -= next;
+		hib_account(&t_read, &t);
 
-		error = hib_wait_on_bio_chain(&bio); /* need all data now */
-		if (error)
-			goto out_finish;
+		for (thr = 0; thr < batch; thr++) {
+			lzo_wait(&data[thr]);
 
-		for (off = 0, i = 0;
-		     off < LZO_HEADER + cmp_len; off += PAGE_SIZE, i++) {
-			memcpy(cmp + off, page[i], PAGE_SIZE);
-		}
+			if (data[thr].ret < 0) {
+				printk(KERN_ERR
+				       "PM: LZO decompression failed\n");
+				error = -1;
+				goto out_finish;
+			}
 
-		unc_len = LZO_UNC_SIZE;
-		error = lzo1x_decompress_safe(cmp + LZO_HEADER, cmp_len,
-		                              unc, &unc_len);
-		if (error < 0) {
-			printk(KERN_ERR "PM: LZO decompression failed\n");
-			break;
+			if (unlikely(!data[thr].unc_len ||
+				     data[thr].unc_len > LZO_UNC_SIZE ||
+				     data[thr].unc_len & (PAGE_SIZE - 1))) {
+				printk(KERN_ERR
+				       "PM: Invalid LZO uncompressed length\n");
+				error = -1;
+				goto out_finish;
+			}
 		}
+		hib_account(&t_dec, &t);
 
-		if (unlikely(!unc_len ||
-		             unc_len > LZO_UNC_SIZE ||
-		             unc_len & (PAGE_SIZE - 1))) {
-			printk(KERN_ERR "PM: Invalid LZO uncompressed length\n");
-			error = -1;
-			break;
-		}
+		crc32_start(crc, batch);
 
-		for (off = 0; off < unc_len; off += PAGE_SIZE) {
-			memcpy(data_of(*snapshot), unc + off, PAGE_SIZE);
+		for (thr = 0; thr < batch; thr++) {
+			for (off = 0; off < data[thr].unc_len;
+			     off += PAGE_SIZE) {
+				memcpy(data_of(*snapshot),
+				       data[thr].unc + off, PAGE_SIZE);
 
-			if (!(nr_pages % m))
-				printk("\b\b\b\b%3d%%", nr_pages / m);
-			nr_pages++;
+				if (!(nr_pages % m))
+					printk("\b\b\b\b%3d%%", nr_pages / m);
+				nr_pages++;
 
-			error = snapshot_write_next(snapshot);
+				error = snapshot_write_next(snapshot);
+				if (error <= 0)
+					break;
+			}
 			if (error <= 0)
-				goto out_finish;
+				break;
 		}
+		hib_account(&t_copy, &t);
+
+		crc32_wait(crc);
+		hib_account(&t_crc, &t);
+
+		if (error <= 0)
+			break;
+		batch = next;
 	}
+	/* ran out of chunks before the image was complete */
+	if (error > 0)
+		error = -ENODATA;
 
 out_finish:
+	err2 = hib_wait_on_bio_chain(&bio);
+	if (!error)
+		error = err2;
 	do_gettimeofday(&stop);
 	if (!error) {
 		printk("\b\b\b\bdone\n");
 		snapshot_write_finalize(snapshot);
 		if (!snapshot_image_loaded(snapshot))
 			error = -ENODATA;
+		else if ((swsusp_header->flags & SF_CRC32_MODE) &&
+			 handle->crc32 != swsusp_header->crc32) {
+			printk(KERN_ERR "PM: Invalid image CRC32!\n");
+			error = -EIO;
+		}
 	} else
 		printk("\n");
 	swsusp_show_speed(&start, &stop, nr_to_read, "Read");
-
-	vfree(cmp);
-	vfree(unc);
-	for (i = 0; i < LZO_CMP_PAGES; i++)
-		free_page((unsigned long)page[i]);
+	printk(KERN_INFO "PM: restore: read %lld ms, io %lld ms, "
+	       "decompress %lld ms, copy %lld ms, crc32 %lld ms\n",
+	       div_s64(t_read, 1000), div_s64(t_io, 1000),
+	       div_s64(t_dec, 1000), div_s64(t_copy, 1000),
+	       div_s64(t_crc, 1000));
+
+	lzo_threads_stop(data, nr_threads, crc);
+out_pages:
+	for (thr = 0; thr < nr_threads; thr++)
+		for (i = 0; i < LZO_CMP_PAGES; i++)
+			if (page[thr][i])
+				free_page((unsigned long)page[thr][i]);
 
 	return error;
 }
@@ -45,6 +45,8 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/* active locks without a timeout, per type; protected by list_lock */
+static int active_no_timeout[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 static int suspend_sys_sync_count;
 static DEFINE_SPINLOCK(suspend_sys_sync_lock);
@@ -61,6 +63,35 @@ static struct wake_lock suspend_backoff_lock;
 
 static unsigned suspend_short_count;
 
+static inline bool wake_lock_counted(struct wake_lock *lock)
+{
+	return (lock->flags & (WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE)) ==
+		WAKE_LOCK_ACTIVE;
+}
+
+/*
+ * Take list_lock on behalf of @lock, charging the time spent spinning to
+ * the lock's contention statistics.
+ */
+static inline void wake_lock_list_lock(struct wake_lock *lock,
+				       unsigned long *irqflags)
+{
+#ifdef CONFIG_WAKELOCK_STAT
+	ktime_t start;
+
+	if (spin_trylock_irqsave(&list_lock, *irqflags))
+		return;
+
+	start = ktime_get();
+	spin_lock_irqsave(&list_lock, *irqflags);
+	lock->stat.contended_count++;
+	lock->stat.contended_time = ktime_add(lock->stat.contended_time,
+					      ktime_sub(ktime_get(), start));
+#else
+	spin_lock_irqsave(&list_lock, *irqflags);
+#endif
+}
+
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
 static ktime_t last_sleep_time_update;
@@ -151,6 +182,37 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int print_lock_contention(struct seq_file *m, struct wake_lock *lock)
+{
+	if (!lock->stat.contended_count)
+		return 0;
+
+	return seq_printf(m, "\"%s\"\t%d\t%lld\n", lock->name,
+			  lock->stat.contended_count,
+			  ktime_to_ns(lock->stat.contended_time));
+}
+
+static int wakelock_contention_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	int type;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	seq_printf(m, "active_no_timeout\t%d\t%d\n",
+		   active_no_timeout[WAKE_LOCK_SUSPEND],
+		   active_no_timeout[WAKE_LOCK_IDLE]);
+	seq_puts(m, "name\tcontended_count\tcontended_time\n");
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_contention(m, lock);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			print_lock_contention(m, lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -246,6 +308,9 @@ static long has_wake_lock_locked(int type)
 	long max_timeout = 0;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
+	/* No need to walk the list while a lock without timeout is held */
+	if (active_no_timeout[type])
+		return -1;
 	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
 		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
 			long timeout = lock->expires - jiffies;
@@ -273,13 +338,16 @@ long has_wake_lock(int type)
 
 static void suspend_sys_sync(struct work_struct *work)
 {
+	ktime_t start = ktime_get();
+
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("PM: Syncing filesystems...\n");
 
 	sys_sync();
 
 	if (debug_mask & DEBUG_SUSPEND)
-		pr_info("sync done.\n");
+		pr_info("sync done in %lld us.\n",
+			ktime_us_delta(ktime_get(), start));
 
 	spin_lock(&suspend_sys_sync_lock);
 	suspend_sys_sync_count--;
@@ -518,6 +586,8 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	lock->stat.contended_count = 0;
+	lock->stat.contended_time = ktime_set(0, 0);
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
@@ -537,6 +607,8 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
+	if (wake_lock_counted(lock))
+		active_no_timeout[lock->flags & WAKE_LOCK_TYPE_MASK]--;
 	lock->flags &= ~WAKE_LOCK_INITIALIZED;
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
@@ -565,7 +637,7 @@ static void wake_lock_internal(
 	unsigned long irqflags;
 	long expire_in;
 
-	spin_lock_irqsave(&list_lock, irqflags);
+	wake_lock_list_lock(lock, &irqflags);
 #ifdef CONFIG_ZTE_HIBERNATE
 	/* ruanmeisi */
 	lock->lock_jiff = jiffies;
@@ -587,6 +659,8 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	if (wake_lock_counted(lock))
+		active_no_timeout[type]--;
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
@@ -608,6 +682,7 @@ static void wake_lock_internal(
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
+		active_no_timeout[type]++;
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
@@ -654,8 +729,21 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
-	spin_lock_irqsave(&list_lock, irqflags);
+
+	/*
+	 * Releasing a lock that is not held changes nothing; don't touch
+	 * list_lock for it. A racing wake_lock() simply orders after us.
+	 * main_wake_lock keeps the slow path, early_suspend() relies on its
+	 * unlock to kick the suspend work.
+	 */
+	if (lock != &main_wake_lock &&
+	    !(ACCESS_ONCE(lock->flags) & WAKE_LOCK_ACTIVE))
+		return;
+
+	wake_lock_list_lock(lock, &irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
+	if (wake_lock_counted(lock))
+		active_no_timeout[type]--;
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 0);
 #endif
@@ -710,6 +798,19 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_contention_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_contention_show, NULL);
+}
+
+static const struct file_operations wakelock_contention_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_contention_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 
 static int __init wakelocks_init(void)
 {
@@ -764,6 +865,8 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelock_contention", S_IRUGO, NULL,
+		    &wakelock_contention_fops);
 #endif
 
 	return 0;
@@ -787,6 +890,7 @@ static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
 	remove_proc_entry("wakelocks", NULL);
+	remove_proc_entry("wakelock_contention", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
 	destroy_workqueue(suspend_sys_sync_work_queue);
@@ -41,6 +41,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 #include <mach/msm_rtb.h>
 #include <asm/uaccess.h>
 #ifndef CONFIG_ZTE_PLATFORM
@@ -121,6 +122,7 @@ static DEFINE_SPINLOCK(logbuf_lock);
 static unsigned log_start;	/* Index into log_buf: next char to be read by syslog() */
 static unsigned con_start;	/* Index into log_buf: next char to be sent to consoles */
 static unsigned log_end;	/* Index into log_buf: most-recently-written-char + 1 */
+static struct task_struct *printk_console_task;	/* drains log_buf to consoles */
 
 /*
  * If exclusive_console is non-NULL then only this console is to be printed to.
@@ -891,7 +893,40 @@ static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
 static int new_text_line = 1;
-static char printk_buf[1024];
+
+/*
+ * Messages are formatted into a per-cpu buffer before logbuf_lock is taken,
+ * so the lock only covers the copy into log_buf.
+ */
+#define PRINTK_BUF_LEN	1024
+static DEFINE_PER_CPU(char [PRINTK_BUF_LEN], printk_cpu_buf);
+static DEFINE_PER_CPU(int, printk_formatting);
+
+/*
+ * When set, printk() only appends to log_buf and leaves calling the console
+ * drivers to printk_console_task. Messages at or below
+ * printk_sync_loglevel, oopses and anything printed before the thread
+ * runs or outside SYSTEM_RUNNING still go to the consoles synchronously.
+ *
+ * Off by default: the deferral covers every console, including memory
+ * consoles such as the ram console, so ordinary messages printed just
+ * before a hang or watchdog reset would be missing from last_kmsg.
+ */
+static int printk_deferred_console;
+module_param_named(deferred_console, printk_deferred_console, bool,
+		   S_IRUGO | S_IWUSR);
+static int printk_sync_loglevel = 2;	/* KERN_CRIT */
+module_param_named(sync_loglevel, printk_sync_loglevel, int,
+		   S_IRUGO | S_IWUSR);
+
+static void printk_defer_console(void);
+
+static inline int printk_console_deferrable(int level)
+{
+	return printk_deferred_console && printk_console_task &&
+		!oops_in_progress && level > printk_sync_loglevel &&
+		system_state == SYSTEM_RUNNING;
+}
 
 int printk_delay_msec __read_mostly;
 
@@ -913,6 +948,8 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	int current_log_level = default_message_loglevel;
 	unsigned long flags;
 	int this_cpu;
+	int recursed = 0;
+	char *buf;
 	char *p;
 	size_t plen;
 	char special;
@@ -928,7 +965,8 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	/*
 	 * Ouch, printk recursed into itself!
 	 */
-	if (unlikely(printk_cpu == this_cpu)) {
+	if (unlikely(printk_cpu == this_cpu ||
+		     __this_cpu_read(printk_formatting))) {
 		/*
 		 * If a crash is occurring during printk() on this CPU,
 		 * then try to get the crash message out but make sure
@@ -943,21 +981,28 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		zap_locks();
 	}
 
+	buf = __get_cpu_var(printk_cpu_buf);
+	__this_cpu_write(printk_formatting, 1);
+	/* Emit the output into the temporary buffer */
+	printed_len = vscnprintf(buf, PRINTK_BUF_LEN, fmt, args);
+	__this_cpu_write(printk_formatting, 0);
+
 	lockdep_off();
 	spin_lock(&logbuf_lock);
 	printk_cpu = this_cpu;
 
 	if (recursion_bug) {
 		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
-		printed_len = strlen(recursion_bug_msg);
+		recursed = 1;
+		if (!new_text_line)
+			emit_log_char('\n');
+		for (p = (char *)recursion_bug_msg; *p; p++)
+			emit_log_char(*p);
+		new_text_line = 1;
+		printed_len += strlen(recursion_bug_msg);
 	}
-	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
 
-
-	p = printk_buf;
+	p = buf;
 
 	/* Read log level and handle special printk prefix */
 	plen = log_prefix(p, &current_log_level, &special);
@@ -991,7 +1036,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				int i;
 
 				for (i = 0; i < plen; i++)
-					emit_log_char(printk_buf[i]);
+					emit_log_char(buf[i]);
 				printed_len += plen;
 			} else {
 				/* Add log prefix */
@@ -1069,8 +1114,15 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The console_trylock_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * Ordinary messages are left for the console thread so that
+	 * slow console drivers don't run in the printing context.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (!recursed && printk_console_deferrable(current_log_level)) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		printk_defer_console();
+	} else if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1334,13 +1386,21 @@ int is_console_locked(void)
 	return console_locked;
 }
 
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_CONSOLE	0x02
+
 static DEFINE_PER_CPU(int, printk_pending);
 
 void printk_tick(void)
 {
-	if (__this_cpu_read(printk_pending)) {
+	int pending = __this_cpu_read(printk_pending);
+
+	if (pending) {
 		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		if ((pending & PRINTK_PENDING_CONSOLE) && printk_console_task)
+			wake_up_process(printk_console_task);
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1354,9 +1414,53 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
+}
+
+#ifdef CONFIG_PRINTK
+/*
+ * The console thread can't be woken directly from printk(), which may be
+ * called with runqueue locks held; kick it from the next tick instead.
+ */
+static void printk_defer_console(void)
+{
+	__this_cpu_or(printk_pending, PRINTK_PENDING_CONSOLE);
 }
 
+static int printk_console_thread(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		/*
+		 * console_unlock() doesn't drain anything while the consoles
+		 * are suspended; resume_console() flushes what piled up.
+		 */
+		if (ACCESS_ONCE(con_start) == ACCESS_ONCE(log_end) ||
+		    ACCESS_ONCE(console_suspended))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init printk_console_thread_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(printk_console_thread, NULL, "printk");
+	if (IS_ERR(task)) {
+		pr_err("printk: unable to start console thread\n");
+		return PTR_ERR(task);
+	}
+	printk_console_task = task;
+	return 0;
+}
+late_initcall(printk_console_thread_init);
+#endif
+
 /**
  * console_unlock - unlock the console system
  *
@@ -40,6 +40,10 @@ static int write_iteration = 50;
 module_param(write_iteration, uint, 0644);
 MODULE_PARM_DESC(write_iteration, "# of writes between timestamp readings");
 
+static unsigned int event_size = 10;
+module_param(event_size, uint, 0644);
+MODULE_PARM_DESC(event_size, "payload bytes per event (12 matches the flight recorder)");
+
 static int producer_nice = 19;
 static int consumer_nice = 19;
 
@@ -235,7 +239,7 @@ static void ring_buffer_producer(void)
 		int i;
 
 		for (i = 0; i < write_iteration; i++) {
-			event = ring_buffer_lock_reserve(buffer, 10);
+			event = ring_buffer_lock_reserve(buffer, event_size);
 			if (!event) {
 				missed++;
 			} else {
@@ -312,6 +316,7 @@ static void ring_buffer_producer(void)
 		trace_printk("WARNING!!! This test is running at lowest priority.\n");
 
 	trace_printk("Time:     %lld (usecs)\n", time);
+	trace_printk("Event size: %u\n", event_size);
 	trace_printk("Overruns: %lld\n", overruns);
 	if (disable_reader)
 		trace_printk("Read:     (reader disabled)\n");
@@ -420,6 +425,10 @@ static int __init ring_buffer_benchmark_init(void)
 {
 	int ret;
 
+	/* the payload carries the writer's cpu id */
+	if (event_size < sizeof(int))
+		event_size = sizeof(int);
+
 	/* make a one meg buffer in overwite mode */
 	buffer = ring_buffer_alloc(1000000, RB_FL_OVERWRITE);
 	if (!buffer)
@@ -0,0 +1,426 @@
+/*
+ * Flight recorder
+ *
+ * Always-on, low overhead record of scheduler, block and cpufreq events.
+ * Events are stored as small binary records in a private per-cpu ring
+ * buffer in overwrite mode, so only the most recent history is kept. The
+ * buffer can be frozen when something interesting happens (a jank report
+ * from userspace, a subsystem restart) and read back through debugfs.
+ */
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/ring_buffer.h>
+#include <linux/sched.h>
+#include <linux/blkdev.h>
+#include <linux/flight_recorder.h>
+#include <trace/events/sched.h>
+#include <trace/events/block.h>
+#include <trace/events/power.h>
+
+enum {
+	FR_SCHED_SWITCH,
+	FR_SCHED_WAKEUP,
+	FR_BLOCK_ISSUE,
+	FR_BLOCK_COMPLETE,
+	FR_CPU_FREQ,
+};
+
+/*
+ * The record is kept to 12 bytes; with the ring buffer event header that
+ * is 16 bytes per event.
+ */
+struct flight_entry {
+	u16	type;
+	u16	flags;
+	u32	a;
+	u32	b;
+};
+
+static struct ring_buffer *flight_buffer;
+static int flight_frozen;
+static DEFINE_MUTEX(flight_mutex);
+
+/* per-cpu buffer size, in KB */
+static unsigned long flight_size_kb = 64;
+module_param_named(size_kb, flight_size_kb, ulong, S_IRUGO);
+
+static int flight_enabled = 1;
+module_param_named(enabled, flight_enabled, int, S_IRUGO);
+
+static inline void flight_record(u16 type, u16 flags, u32 a, u32 b)
+{
+	struct ring_buffer_event *event;
+	struct flight_entry *entry;
+
+	event = ring_buffer_lock_reserve(flight_buffer, sizeof(*entry));
+	if (!event)
+		return;
+	entry = ring_buffer_event_data(event);
+	entry->type = type;
+	entry->flags = flags;
+	entry->a = a;
+	entry->b = b;
+	ring_buffer_unlock_commit(flight_buffer, event);
+}
+
+static void
+probe_flight_switch(void *ignore, struct task_struct *prev,
+		    struct task_struct *next)
+{
+	flight_record(FR_SCHED_SWITCH, prev->state & 0xffff,
+		      prev->pid, next->pid);
+}
+
+static void
+probe_flight_wakeup(void *ignore, struct task_struct *p, int success)
+{
+	flight_record(FR_SCHED_WAKEUP, task_cpu(p), p->pid, success);
+}
+
+#ifdef CONFIG_BLOCK
+static void
+probe_flight_rq_issue(void *ignore, struct request_queue *q,
+		      struct request *rq)
+{
+	flight_record(FR_BLOCK_ISSUE, rq_data_dir(rq),
+		      (u32)blk_rq_pos(rq), blk_rq_sectors(rq));
+}
+
+static void
+probe_flight_rq_complete(void *ignore, struct request_queue *q,
+			 struct request *rq)
+{
+	flight_record(FR_BLOCK_COMPLETE, rq_data_dir(rq) | (rq->errors << 1),
+		      (u32)blk_rq_pos(rq), blk_rq_sectors(rq));
+}
+#endif
+
+static void
+probe_flight_cpu_freq(void *ignore, unsigned int frequency,
+		      unsigned int cpu_id)
+{
+	flight_record(FR_CPU_FREQ, 0, frequency, cpu_id);
+}
+
+static int flight_register_probes(void)
+{
+	int ret;
+
+	ret = register_trace_sched_switch(probe_flight_switch, NULL);
+	if (ret)
+		return ret;
+	ret = register_trace_sched_wakeup(probe_flight_wakeup, NULL);
+	if (ret)
+		goto fail_switch;
+	ret = register_trace_sched_wakeup_new(probe_flight_wakeup, NULL);
+	if (ret)
+		goto fail_wakeup;
+#ifdef CONFIG_BLOCK
+	ret = register_trace_block_rq_issue(probe_flight_rq_issue, NULL);
+	if (ret)
+		goto fail_wakeup_new;
+	ret = register_trace_block_rq_complete(probe_flight_rq_complete, NULL);
+	if (ret)
+		goto fail_issue;
+#endif
+	ret = register_trace_cpu_frequency(probe_flight_cpu_freq, NULL);
+	if (ret)
+		goto fail_complete;
+	return 0;
+
+fail_complete:
+#ifdef CONFIG_BLOCK
+	unregister_trace_block_rq_complete(probe_flight_rq_complete, NULL);
+fail_issue:
+	unregister_trace_block_rq_issue(probe_flight_rq_issue, NULL);
+fail_wakeup_new:
+#endif
+	unregister_trace_sched_wakeup_new(probe_flight_wakeup, NULL);
+fail_wakeup:
+	unregister_trace_sched_wakeup(probe_flight_wakeup, NULL);
+fail_switch:
+	unregister_trace_sched_switch(probe_flight_switch, NULL);
+	return ret;
+}
+
+/**
+ * flight_recorder_freeze - stop recording to keep the current history
+ * @reason: short description logged with the freeze
+ *
+ * Recording resumes once "0" is written to the debugfs freeze file.
+ */
+void flight_recorder_freeze(const char *reason)
+{
+	if (!flight_buffer)
+		return;
+
+	mutex_lock(&flight_mutex);
+	if (!flight_frozen) {
+		ring_buffer_record_disable(flight_buffer);
+		flight_frozen = 1;
+		pr_info("flight_recorder: frozen (%s)\n", reason);
+	}
+	mutex_unlock(&flight_mutex);
+}
+EXPORT_SYMBOL(flight_recorder_freeze);
+
+static void flight_recorder_thaw(void)
+{
+	mutex_lock(&flight_mutex);
+	if (flight_frozen) {
+		ring_buffer_record_enable(flight_buffer);
+		flight_frozen = 0;
+	}
+	mutex_unlock(&flight_mutex);
+}
+
+/*
+ * Reading merges the per-cpu buffers by timestamp. The iterators don't
+ * consume, so the history can be dumped more than once.
+ */
+struct flight_iter {
+	struct ring_buffer_iter	*iter[NR_CPUS];
+	struct flight_entry	*entry;
+	u64			ts;
+	int			cpu;
+	loff_t			pos;
+};
+
+static struct flight_entry *flight_peek(struct flight_iter *fi)
+{
+	struct ring_buffer_event *event, *next = NULL;
+	u64 ts, next_ts = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (!fi->iter[cpu])
+			continue;
+		event = ring_buffer_iter_peek(fi->iter[cpu], &ts);
+		if (event && (!next || ts < next_ts)) {
+			next = event;
+			next_ts = ts;
+			fi->cpu = cpu;
+		}
+	}
+	fi->entry = next ? ring_buffer_event_data(next) : NULL;
+	fi->ts = next_ts;
+	return fi->entry;
+}
+
+static void *flight_start(struct seq_file *m, loff_t *pos)
+{
+	struct flight_iter *fi = m->private;
+
+	if (*pos == 0 && fi->pos == 0)
+		return flight_peek(fi) ? fi : NULL;
+	if (*pos != fi->pos)
+		return NULL;
+	return fi->entry ? fi : NULL;
+}
+
+static void *flight_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct flight_iter *fi = m->private;
+
+	ring_buffer_read(fi->iter[fi->cpu], NULL);
+	fi->pos = ++(*pos);
+	return flight_peek(fi) ? fi : NULL;
+}
+
+static void flight_stop(struct seq_file *m, void *v)
+{
+}
+
+static int flight_show(struct seq_file *m, void *v)
+{
+	struct flight_iter *fi = v;
+	struct flight_entry *e = fi->entry;
+	unsigned long usec_rem;
+	u64 t = fi->ts;
+
+	usec_rem = do_div(t, NSEC_PER_SEC) / NSEC_PER_USEC;
+	seq_printf(m, "%3d %5lu.%06lu ", fi->cpu, (unsigned long)t, usec_rem);
+
+	switch (e->type) {
+	case FR_SCHED_SWITCH:
+		seq_printf(m, "switch   prev=%u state=%u next=%u\n",
+			   e->a, e->flags, e->b);
+		break;
+	case FR_SCHED_WAKEUP:
+		seq_printf(m, "wakeup   pid=%u target_cpu=%u success=%u\n",
+			   e->a, e->flags, e->b);
+		break;
+	case FR_BLOCK_ISSUE:
+	case FR_BLOCK_COMPLETE:
+		seq_printf(m, "%s %c sector=%u nr=%u%s\n",
+			   e->type == FR_BLOCK_ISSUE ? "rq_issue" : "rq_done ",
+			   e->flags & 1 ? 'W' : 'R', e->a, e->b,
+			   e->flags >> 1 ? " error" : "");
+		break;
+	case FR_CPU_FREQ:
+		seq_printf(m, "cpufreq  cpu=%u freq=%u\n", e->b, e->a);
+		break;
+	default:
+		seq_printf(m, "unknown  type=%u\n", e->type);
+	}
+	return 0;
+}
+
+static const struct seq_operations flight_seq_ops = {
+	.start = flight_start,
+	.next = flight_next,
+	.stop = flight_stop,
+	.show = flight_show,
+};
+
+static int flight_events_open(struct inode *inode, struct file *file)
+{
+	struct flight_iter *fi;
+	int cpu;
+	int ret;
+
+	fi = kzalloc(sizeof(*fi), GFP_KERNEL);
+	if (!fi)
+		return -ENOMEM;
+
+	for_each_online_cpu(cpu)
+		fi->iter[cpu] = ring_buffer_read_prepare(flight_buffer, cpu);
+	ring_buffer_read_prepare_sync();
+	for_each_online_cpu(cpu)
+		if (fi->iter[cpu])
+			ring_buffer_read_start(fi->iter[cpu]);
+
+	ret = seq_open(file, &flight_seq_ops);
+	if (ret) {
+		for_each_possible_cpu(cpu)
+			if (fi->iter[cpu])
+				ring_buffer_read_finish(fi->iter[cpu]);
+		kfree(fi);
+		return ret;
+	}
+	((struct seq_file *)file->private_data)->private = fi;
+	return 0;
+}
+
+static int flight_events_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+	struct flight_iter *fi = m->private;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (fi->iter[cpu])
+			ring_buffer_read_finish(fi->iter[cpu]);
+	kfree(fi);
+	return seq_release(inode, file);
+}
+
+static const struct file_operations flight_events_fops = {
+	.open = flight_events_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = flight_events_release,
+};
+
+static ssize_t flight_freeze_read(struct file *file, char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	char buf[4];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "%d\n", flight_frozen);
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+}
+
+static ssize_t flight_freeze_write(struct file *file, const char __user *ubuf,
+				   size_t cnt, loff_t *ppos)
+{
+	unsigned long val;
+	int ret;
+
+	ret = kstrtoul_from_user(ubuf, cnt, 10, &val);
+	if (ret)
+		return ret;
+
+	if (val)
+		flight_recorder_freeze("user");
+	else
+		flight_recorder_thaw();
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations flight_freeze_fops = {
+	.read = flight_freeze_read,
+	.write = flight_freeze_write,
+	.llseek = generic_file_llseek,
+};
+
+static ssize_t flight_reset_write(struct file *file, const char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	ring_buffer_reset(flight_buffer);
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations flight_reset_fops = {
+	.write = flight_reset_write,
+	.llseek = generic_file_llseek,
+};
+
+static ssize_t flight_stats_read(struct file *file, char __user *ubuf,
+				 size_t cnt, loff_t *ppos)
+{
+	char buf[96];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "entries: %lu\noverruns: %lu\n",
+		       ring_buffer_entries(flight_buffer),
+		       ring_buffer_overruns(flight_buffer));
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+}
+
+static const struct file_operations flight_stats_fops = {
+	.read = flight_stats_read,
+	.llseek = generic_file_llseek,
+};
+
+static int __init flight_recorder_init(void)
+{
+	struct dentry *dir;
+	int ret;
+
+	if (!flight_enabled)
+		return 0;
+
+	flight_buffer = ring_buffer_alloc(flight_size_kb << 10,
+					  RB_FL_OVERWRITE);
+	if (!flight_buffer)
+		return -ENOMEM;
+
+	ret = flight_register_probes();
+	if (ret) {
+		pr_err("flight_recorder: failed to register probes %d\n", ret);
+		ring_buffer_free(flight_buffer);
+		flight_buffer = NULL;
+		return ret;
+	}
+
+	dir = debugfs_create_dir("flight_recorder", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+	debugfs_create_file("events", S_IRUSR, dir, NULL, &flight_events_fops);
+	debugfs_create_file("freeze", S_IRUSR | S_IWUSR, dir, NULL,
+			    &flight_freeze_fops);
+	debugfs_create_file("reset", S_IWUSR, dir, NULL, &flight_reset_fops);
+	debugfs_create_file("stats", S_IRUSR, dir, NULL, &flight_stats_fops);
+	return 0;
+}
+late_initcall(flight_recorder_init);
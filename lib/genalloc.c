@@ -15,6 +15,8 @@
 #include <linux/bitmap.h>
 #include <linux/genalloc.h>
 #include <linux/vmalloc.h>
+#include <linux/rbtree.h>
+#include <linux/log2.h>
 
 /* General purpose special memory pool descriptor. */
 struct gen_pool {
@@ -23,16 +25,218 @@ struct gen_pool {
 	unsigned order;			/* minimum allocation order */
 };
 
-/* General purpose special memory pool chunk descriptor. */
+/*
+ * General purpose special memory pool chunk descriptor.
+ *
+ * The bitmap is authoritative. The free runs of bits are also indexed as
+ * extents in two rbtrees, one ordered by size and one by address, so that
+ * allocation is a best-fit tree lookup instead of a linear bitmap scan
+ * and free can merge with its neighbours directly. Extents are allocated
+ * atomically under the chunk lock; if that fails the index is dropped and
+ * the chunk falls back to scanning the bitmap until it can be rebuilt.
+ */
 struct gen_pool_chunk {
-	spinlock_t lock;		/* protects bits */
+	spinlock_t lock;		/* protects bits and the extent index */
 	struct list_head next_chunk;	/* next chunk in pool */
 	phys_addr_t phys_addr;		/* physical starting address of memory chunk */
 	unsigned long start;		/* start of memory chunk */
 	unsigned long size;		/* number of bits */
+	struct rb_root by_size;		/* free extents by length, then start */
+	struct rb_root by_addr;		/* free extents by start */
+	bool indexed;			/* by_size and by_addr match bits */
 	unsigned long bits[0];		/* bitmap for allocating memory chunk */
 };
 
+/* A run of free bits in a chunk */
+struct gen_pool_extent {
+	struct rb_node size_node;
+	struct rb_node addr_node;
+	unsigned long start;		/* first free bit */
+	unsigned long len;		/* number of free bits */
+};
+
+static void extent_insert(struct gen_pool_chunk *chunk,
+			  struct gen_pool_extent *e)
+{
+	struct rb_node **p, *parent;
+	struct gen_pool_extent *tmp;
+
+	p = &chunk->by_size.rb_node;
+	parent = NULL;
+	while (*p) {
+		parent = *p;
+		tmp = rb_entry(parent, struct gen_pool_extent, size_node);
+		if (e->len < tmp->len ||
+		    (e->len == tmp->len && e->start < tmp->start))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&e->size_node, parent, p);
+	rb_insert_color(&e->size_node, &chunk->by_size);
+
+	p = &chunk->by_addr.rb_node;
+	parent = NULL;
+	while (*p) {
+		parent = *p;
+		tmp = rb_entry(parent, struct gen_pool_extent, addr_node);
+		if (e->start < tmp->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&e->addr_node, parent, p);
+	rb_insert_color(&e->addr_node, &chunk->by_addr);
+}
+
+static void extent_erase(struct gen_pool_chunk *chunk,
+			 struct gen_pool_extent *e)
+{
+	rb_erase(&e->size_node, &chunk->by_size);
+	rb_erase(&e->addr_node, &chunk->by_addr);
+}
+
+static void chunk_drop_index(struct gen_pool_chunk *chunk)
+{
+	struct rb_node *n;
+
+	while ((n = rb_first(&chunk->by_addr))) {
+		struct gen_pool_extent *e;
+
+		e = rb_entry(n, struct gen_pool_extent, addr_node);
+		extent_erase(chunk, e);
+		kfree(e);
+	}
+	chunk->indexed = false;
+}
+
+static int chunk_build_index(struct gen_pool_chunk *chunk, gfp_t gfp)
+{
+	unsigned long start = 0, end;
+	struct gen_pool_extent *e;
+
+	for (;;) {
+		start = find_next_zero_bit(chunk->bits, chunk->size, start);
+		if (start >= chunk->size)
+			break;
+		end = find_next_bit(chunk->bits, chunk->size, start);
+
+		e = kmalloc(sizeof(*e), gfp);
+		if (!e) {
+			chunk_drop_index(chunk);
+			return -ENOMEM;
+		}
+		e->start = start;
+		e->len = end - start;
+		extent_insert(chunk, e);
+		start = end;
+	}
+	chunk->indexed = true;
+	return 0;
+}
+
+/*
+ * Find the smallest free extent that can hold @nr bits at the requested
+ * alignment, carve the allocation out of it and return its first bit, or
+ * chunk->size if nothing fits. The caller sets the bits.
+ */
+static unsigned long chunk_index_alloc(struct gen_pool_chunk *chunk,
+				       unsigned long nr,
+				       unsigned long align_mask)
+{
+	struct rb_node *n = chunk->by_size.rb_node, *first = NULL;
+	struct gen_pool_extent *e = NULL;
+	unsigned long start = 0, end;
+
+	while (n) {
+		e = rb_entry(n, struct gen_pool_extent, size_node);
+		if (e->len >= nr) {
+			first = n;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	for (n = first; n; n = rb_next(n)) {
+		e = rb_entry(n, struct gen_pool_extent, size_node);
+		start = ((chunk->start + e->start + align_mask) & ~align_mask) -
+			chunk->start;
+		if (start + nr <= e->start + e->len)
+			break;
+	}
+	if (!n)
+		return chunk->size;
+
+	end = e->start + e->len;
+	extent_erase(chunk, e);
+	if (start > e->start) {
+		e->len = start - e->start;
+		extent_insert(chunk, e);
+		e = NULL;
+	}
+	if (start + nr < end) {
+		if (!e)
+			e = kmalloc(sizeof(*e), GFP_ATOMIC);
+		if (!e) {
+			chunk_drop_index(chunk);
+			return start;
+		}
+		e->start = start + nr;
+		e->len = end - e->start;
+		extent_insert(chunk, e);
+		e = NULL;
+	}
+	kfree(e);
+	return start;
+}
+
+/* Return @nr bits at @start to the index, merging with free neighbours. */
+static void chunk_index_free(struct gen_pool_chunk *chunk,
+			     unsigned long start, unsigned long nr)
+{
+	struct rb_node *n = chunk->by_addr.rb_node;
+	struct gen_pool_extent *e, *prev = NULL, *next = NULL;
+	unsigned long end = start + nr;
+
+	while (n) {
+		e = rb_entry(n, struct gen_pool_extent, addr_node);
+		if (e->start < start) {
+			prev = e;
+			n = n->rb_right;
+		} else {
+			next = e;
+			n = n->rb_left;
+		}
+	}
+	if (prev && prev->start + prev->len != start)
+		prev = NULL;
+	if (next && next->start != end)
+		next = NULL;
+
+	if (prev) {
+		extent_erase(chunk, prev);
+		start = prev->start;
+	}
+	if (next) {
+		extent_erase(chunk, next);
+		end = next->start + next->len;
+	}
+
+	e = prev ? prev : next;
+	if (prev && next)
+		kfree(next);
+	if (!e)
+		e = kmalloc(sizeof(*e), GFP_ATOMIC);
+	if (!e) {
+		chunk_drop_index(chunk);
+		return;
+	}
+	e->start = start;
+	e->len = end - start;
+	extent_insert(chunk, e);
+}
+
 /**
  * gen_pool_create() - create a new special memory pool
  * @order:	Log base 2 of number of bytes each bitmap bit
@@ -104,6 +308,9 @@ int __must_check gen_pool_add_virt(struct gen_pool *pool, unsigned long virt, ph
 	chunk->phys_addr = phys;
 	chunk->start = virt >> pool->order;
 	chunk->size  = size;
+	chunk->by_size = RB_ROOT;
+	chunk->by_addr = RB_ROOT;
+	chunk_build_index(chunk, GFP_KERNEL);
 
 	write_lock(&pool->lock);
 	list_add(&chunk->next_chunk, &pool->chunks);
@@ -124,18 +331,21 @@ phys_addr_t gen_pool_virt_to_phys(struct gen_pool *pool, unsigned long addr)
 {
 	struct list_head *_chunk;
 	struct gen_pool_chunk *chunk;
+	phys_addr_t paddr = -1;
 
 	read_lock(&pool->lock);
 	list_for_each(_chunk, &pool->chunks) {
 		chunk = list_entry(_chunk, struct gen_pool_chunk, next_chunk);
 
 		if (addr >= chunk->start &&
-		    addr < (chunk->start + chunk->size))
-			return chunk->phys_addr + addr - chunk->start;
+		    addr < (chunk->start + chunk->size)) {
+			paddr = chunk->phys_addr + addr - chunk->start;
+			break;
+		}
 	}
 	read_unlock(&pool->lock);
 
-	return -1;
+	return paddr;
 }
 EXPORT_SYMBOL(gen_pool_virt_to_phys);
 
@@ -159,6 +369,7 @@ void gen_pool_destroy(struct gen_pool *pool)
 
 		bit = find_next_bit(chunk->bits, chunk->size, 0);
 		BUG_ON(bit < chunk->size);
+		chunk_drop_index(chunk);
 
 		nbytes = sizeof *chunk + BITS_TO_LONGS(chunk->size) *
 			sizeof *chunk->bits;
@@ -181,7 +392,8 @@ EXPORT_SYMBOL(gen_pool_destroy);
  *			must be aligned to 1MiB).
  *
  * Allocate the requested number of bytes from the specified pool.
- * Uses a first-fit algorithm.
+ * Uses a best-fit algorithm within each chunk, preferring the lowest
+ * address among equally sized free extents.
  */
 unsigned long __must_check
 gen_pool_alloc_aligned(struct gen_pool *pool, size_t size,
@@ -204,9 +416,15 @@ gen_pool_alloc_aligned(struct gen_pool *pool, size_t size,
 			continue;
 
 		spin_lock_irqsave(&chunk->lock, flags);
-		start = bitmap_find_next_zero_area_off(chunk->bits, chunk->size,
-						       0, size, align_mask,
-						       chunk->start);
+		if (!chunk->indexed)
+			chunk_build_index(chunk, GFP_ATOMIC);
+		if (chunk->indexed)
+			start = chunk_index_alloc(chunk, size, align_mask);
+		else
+			start = bitmap_find_next_zero_area_off(chunk->bits,
+							       chunk->size, 0,
+							       size, align_mask,
+							       chunk->start);
 		if (start >= chunk->size) {
 			spin_unlock_irqrestore(&chunk->lock, flags);
 			continue;
@@ -252,6 +470,9 @@ void gen_pool_free(struct gen_pool *pool, unsigned long addr, size_t size)
 		    addr + size <= chunk->start + chunk->size) {
 			spin_lock_irqsave(&chunk->lock, flags);
 			bitmap_clear(chunk->bits, addr - chunk->start, size);
+			if (chunk->indexed)
+				chunk_index_free(chunk, addr - chunk->start,
+						 size);
 			spin_unlock_irqrestore(&chunk->lock, flags);
 			goto done;
 		}
@@ -260,3 +481,48 @@ done:
 	read_unlock(&pool->lock);
 }
 EXPORT_SYMBOL(gen_pool_free);
+
+/**
+ * gen_pool_get_stats() - report how fragmented a pool is
+ * @pool:	Pool to examine.
+ * @stats:	Filled in with the pool size, free space, largest free
+ *		extent and a histogram of free extents by log2 of their
+ *		size in bytes.
+ *
+ * Walks the bitmaps, so the result is exact even for chunks whose extent
+ * index was dropped.
+ */
+void gen_pool_get_stats(struct gen_pool *pool, struct gen_pool_stats *stats)
+{
+	struct gen_pool_chunk *chunk;
+	unsigned long flags, start, end;
+	size_t len;
+
+	memset(stats, 0, sizeof(*stats));
+
+	read_lock(&pool->lock);
+	list_for_each_entry(chunk, &pool->chunks, next_chunk) {
+		stats->nr_chunks++;
+		stats->size += chunk->size << pool->order;
+
+		spin_lock_irqsave(&chunk->lock, flags);
+		if (!chunk->indexed)
+			stats->nr_unindexed++;
+		for (start = 0; ; start = end) {
+			start = find_next_zero_bit(chunk->bits, chunk->size,
+						   start);
+			if (start >= chunk->size)
+				break;
+			end = find_next_bit(chunk->bits, chunk->size, start);
+
+			len = (end - start) << pool->order;
+			stats->avail += len;
+			stats->largest = max(stats->largest, len);
+			stats->nr_extents++;
+			stats->extents[ilog2(len)]++;
+		}
+		spin_unlock_irqrestore(&chunk->lock, flags);
+	}
+	read_unlock(&pool->lock);
+}
+EXPORT_SYMBOL(gen_pool_get_stats);
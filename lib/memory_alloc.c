@@ -84,6 +84,44 @@ static int mempool_open(struct inode *inode, struct file *file)
 	return seq_open(file, &mempool_op);
 }
 
+/*
+ * Per pool fragmentation: free space, the largest free extent and how
+ * the free extents are spread over power of two size classes. frag is
+ * the share of free memory that is not in the largest extent.
+ */
+static int mempool_frag_show(struct seq_file *m, void *unused)
+{
+	struct gen_pool_stats st;
+	unsigned long frag;
+	int i, order;
+
+	for (i = 0; i < ARRAY_SIZE(mpools); i++) {
+		if (!mpools[i].gpool)
+			continue;
+
+		gen_pool_get_stats(mpools[i].gpool, &st);
+		frag = st.avail ? 100 - st.largest * 100 / st.avail : 0;
+
+		seq_printf(m, "pool %d: size %zu free %zu largest %zu "
+			   "extents %lu frag %lu%%", i, st.size, st.avail,
+			   st.largest, st.nr_extents, frag);
+		if (st.nr_unindexed)
+			seq_printf(m, " unindexed %lu", st.nr_unindexed);
+		seq_puts(m, "\n  free extents:");
+		for (order = 0; order < ARRAY_SIZE(st.extents); order++)
+			if (st.extents[order])
+				seq_printf(m, " %luK:%lu", (1UL << order) >> 10,
+					   st.extents[order]);
+		seq_puts(m, "\n");
+	}
+	return 0;
+}
+
+static int mempool_frag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mempool_frag_show, NULL);
+}
+
 static struct alloc *find_alloc(void *addr)
 {
 	struct rb_root *root = &alloc_root;
@@ -390,6 +428,14 @@ static const struct file_operations mempool_operations = {
 	.release        = seq_release_private,
 };
 
+static const struct file_operations mempool_frag_operations = {
+	.owner		= THIS_MODULE,
+	.open           = mempool_frag_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 int __init memory_pool_init(void)
 {
 	int i;
@@ -416,8 +462,16 @@ static int __init debugfs_mempool_init(void)
 	entry = debugfs_create_file("map", S_IRUSR, dir,
 		NULL, &mempool_operations);
 
-	if (!entry)
+	if (!entry) {
 		pr_err("Cannot create /sys/kernel/debug/mempool/map");
+		return -EINVAL;
+	}
+
+	entry = debugfs_create_file("frag", S_IRUSR, dir,
+		NULL, &mempool_frag_operations);
+
+	if (!entry)
+		pr_err("Cannot create /sys/kernel/debug/mempool/frag");
 
 	return entry ? 0 : -EINVAL;
 }
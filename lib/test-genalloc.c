@@ -0,0 +1,114 @@
+/*
+ * gen_pool alloc/free churn benchmark
+ *
+ * Builds a pool over a made up address range, which is never touched,
+ * and keeps a window of live allocations of mixed sizes and alignments
+ * cycling through it, the way camera and video buffers cycle through a
+ * carveout. Reports the average cost of an allocation and a free and how
+ * fragmented the pool ended up.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/genalloc.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+
+#define POOL_BASE	0x40000000UL
+
+static unsigned int pool_mb = 256;
+module_param(pool_mb, uint, 0444);
+MODULE_PARM_DESC(pool_mb, "size of the pool in MB");
+
+static unsigned int iterations = 100000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "number of alloc/free rounds");
+
+static unsigned int live = 256;
+module_param(live, uint, 0444);
+MODULE_PARM_DESC(live, "number of allocations kept live");
+
+static unsigned int max_pages = 512;
+module_param(max_pages, uint, 0444);
+MODULE_PARM_DESC(max_pages, "largest allocation in pages");
+
+struct churn_alloc {
+	unsigned long addr;
+	size_t size;
+};
+
+static int __init test_genalloc_init(void)
+{
+	struct churn_alloc *slots;
+	struct gen_pool_stats st;
+	struct gen_pool *pool;
+	s64 alloc_ns = 0, free_ns = 0;
+	unsigned long nr_alloc = 0, nr_free = 0, failed = 0;
+	unsigned int i, slot;
+	ktime_t t;
+
+	if (!pool_mb || !live || !max_pages)
+		return -EINVAL;
+
+	slots = kcalloc(live, sizeof(*slots), GFP_KERNEL);
+	if (!slots)
+		return -ENOMEM;
+
+	pool = gen_pool_create(PAGE_SHIFT, -1);
+	if (!pool) {
+		kfree(slots);
+		return -ENOMEM;
+	}
+	if (gen_pool_add(pool, POOL_BASE, (size_t)pool_mb << 20, -1)) {
+		gen_pool_destroy(pool);
+		kfree(slots);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < iterations; i++) {
+		struct churn_alloc *a;
+
+		slot = random32() % live;
+		a = &slots[slot];
+
+		if (a->addr) {
+			t = ktime_get();
+			gen_pool_free(pool, a->addr, a->size);
+			free_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+			nr_free++;
+			a->addr = 0;
+		}
+
+		a->size = ((random32() % max_pages) + 1) << PAGE_SHIFT;
+		t = ktime_get();
+		a->addr = gen_pool_alloc_aligned(pool, a->size,
+						 PAGE_SHIFT + random32() % 9);
+		alloc_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+		nr_alloc++;
+		if (!a->addr)
+			failed++;
+	}
+
+	gen_pool_get_stats(pool, &st);
+
+	pr_info("test_genalloc: %lu allocs %lld ns avg, %lu failed; "
+		"%lu frees %lld ns avg\n",
+		nr_alloc, nr_alloc ? div_s64(alloc_ns, nr_alloc) : 0, failed,
+		nr_free, nr_free ? div_s64(free_ns, nr_free) : 0);
+	pr_info("test_genalloc: free %zu of %zu bytes in %lu extents, "
+		"largest %zu\n", st.avail, st.size, st.nr_extents,
+		st.largest);
+
+	for (slot = 0; slot < live; slot++)
+		if (slots[slot].addr)
+			gen_pool_free(pool, slots[slot].addr, slots[slot].size);
+	gen_pool_destroy(pool);
+	kfree(slots);
+
+	/* Nothing to keep loaded, the results are in the log */
+	return -EAGAIN;
+}
+module_init(test_genalloc_init);
+MODULE_LICENSE("GPL");
@@ -0,0 +1,134 @@
+/*
+ * printk() flood latency benchmark
+ *
+ * Starts one thread per online cpu, each printing a burst of messages
+ * with interrupts off, the way a chatty interrupt handler does, and
+ * reports how long the callers spent inside printk(). Load it once with
+ * printk.deferred_console=0 and once with it set to compare synchronous
+ * and deferred console output.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+
+static unsigned int count = 2000;
+module_param(count, uint, 0444);
+MODULE_PARM_DESC(count, "messages printed by each cpu");
+
+static unsigned int level = 6;
+module_param(level, uint, 0444);
+MODULE_PARM_DESC(level, "log level of the messages (0-7)");
+
+static unsigned int len = 80;
+module_param(len, uint, 0444);
+MODULE_PARM_DESC(len, "length of each message");
+
+struct flood_cpu {
+	struct completion done;
+	int started;
+	s64 total_ns;
+	s64 max_ns;
+	unsigned int printed;
+};
+
+static char flood_text[256];
+static DECLARE_COMPLETION(flood_start);
+
+static int test_printk_flood(void *data)
+{
+	struct flood_cpu *fc = data;
+	unsigned long flags;
+	unsigned int i;
+	ktime_t t;
+	s64 ns;
+
+	wait_for_completion(&flood_start);
+
+	for (i = 0; i < count; i++) {
+		local_irq_save(flags);
+		t = ktime_get();
+		printk("<%u>test_printk: cpu%d %u %s\n", level,
+		       smp_processor_id(), i, flood_text);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+		local_irq_restore(flags);
+
+		fc->total_ns += ns;
+		if (ns > fc->max_ns)
+			fc->max_ns = ns;
+		fc->printed++;
+	}
+
+	complete(&fc->done);
+	return 0;
+}
+
+static int __init test_printk_init(void)
+{
+	struct flood_cpu *fcs;
+	struct task_struct *task;
+	s64 total_ns = 0, max_ns = 0;
+	unsigned long printed = 0;
+	ktime_t t;
+	int cpu, started = 0;
+
+	if (!count || level > 7)
+		return -EINVAL;
+
+	len = clamp_t(unsigned int, len, 1, sizeof(flood_text) - 1);
+	memset(flood_text, 'x', len);
+	flood_text[len] = '\0';
+
+	fcs = kcalloc(nr_cpu_ids, sizeof(*fcs), GFP_KERNEL);
+	if (!fcs)
+		return -ENOMEM;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		init_completion(&fcs[cpu].done);
+		task = kthread_create(test_printk_flood, &fcs[cpu],
+				      "test_printk/%d", cpu);
+		if (IS_ERR(task))
+			continue;
+		kthread_bind(task, cpu);
+		fcs[cpu].started = 1;
+		wake_up_process(task);
+		started++;
+	}
+
+	t = ktime_get();
+	complete_all(&flood_start);
+	for_each_online_cpu(cpu)
+		if (fcs[cpu].started)
+			wait_for_completion(&fcs[cpu].done);
+	t = ktime_sub(ktime_get(), t);
+	put_online_cpus();
+
+	for_each_possible_cpu(cpu) {
+		if (!fcs[cpu].printed)
+			continue;
+		pr_info("test_printk: cpu%d %u printks %lld ns avg, "
+			"%lld ns max\n", cpu, fcs[cpu].printed,
+			div_s64(fcs[cpu].total_ns, fcs[cpu].printed),
+			fcs[cpu].max_ns);
+		printed += fcs[cpu].printed;
+		total_ns += fcs[cpu].total_ns;
+		max_ns = max(max_ns, fcs[cpu].max_ns);
+	}
+	pr_info("test_printk: %d cpus %lu printks at level %u in %lld us, "
+		"%lld ns avg, %lld ns max\n", started, printed, level,
+		ktime_to_us(t), printed ? div_s64(total_ns, printed) : 0,
+		max_ns);
+
+	kfree(fcs);
+
+	/* Nothing to keep loaded, the results are in the log */
+	return -EAGAIN;
+}
+module_init(test_printk_init);
+MODULE_LICENSE("GPL");
@@ -50,6 +50,7 @@ static struct snd_pcm_hardware msm_pcm_hardware_capture = {
 				SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				SNDRV_PCM_INFO_MMAP_VALID |
 				SNDRV_PCM_INFO_INTERLEAVED |
+				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
 				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
 	.formats =              SNDRV_PCM_FMTBIT_S16_LE,
 	.rates =                SNDRV_PCM_RATE_8000_48000,
@@ -70,6 +71,7 @@ static struct snd_pcm_hardware msm_pcm_hardware_playback = {
 				SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				SNDRV_PCM_INFO_MMAP_VALID |
 				SNDRV_PCM_INFO_INTERLEAVED |
+				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
 				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
 	.formats =              SNDRV_PCM_FMTBIT_S16_LE,
 	.rates =                SNDRV_PCM_RATE_8000_48000 | SNDRV_PCM_RATE_KNOT,
@@ -98,6 +100,20 @@ static struct snd_pcm_hw_constraint_list constraints_sample_rates = {
 	.mask = 0,
 };
 
+/*
+ * In mmap mode the buffer-done events from the DSP already queue the next
+ * buffer, so userspace does not need to be woken per period. When it asked
+ * for no period wakeups it tracks the hardware pointer itself through
+ * hwsync/status, which goes through msm_pcm_pointer().
+ */
+static inline int msm_pcm_period_wakeup(struct msm_audio *prtd)
+{
+	struct snd_pcm_substream *substream = prtd->substream;
+
+	return !(prtd->mmap_flag && substream->runtime &&
+		 substream->runtime->no_period_wakeup);
+}
+
 static void event_handler(uint32_t opcode,
 		uint32_t token, uint32_t *payload, void *priv)
 {
@@ -134,7 +150,7 @@ static void event_handler(uint32_t opcode,
 		pr_debug("ASM_DATA_EVENT_WRITE_DONE\n");
 		pr_debug("Buffer Consumed = 0x%08x\n", *ptrmem);
 		prtd->pcm_irq_pos += prtd->pcm_count;
-		if (atomic_read(&prtd->start))
+		if (atomic_read(&prtd->start) && msm_pcm_period_wakeup(prtd))
 			snd_pcm_period_elapsed(substream);
 		atomic_inc(&prtd->out_count);
 		wake_up(&the_locks.write_wait);
@@ -166,7 +182,7 @@ static void event_handler(uint32_t opcode,
 		in_frame_info[token][1] = payload[3];
 		prtd->pcm_irq_pos += in_frame_info[token][0];
 		pr_debug("pcm_irq_pos=%d\n", prtd->pcm_irq_pos);
-		if (atomic_read(&prtd->start))
+		if (atomic_read(&prtd->start) && msm_pcm_period_wakeup(prtd))
 			snd_pcm_period_elapsed(substream);
 		if (atomic_read(&prtd->in_count) <= prtd->periods)
 			atomic_inc(&prtd->in_count);
@@ -616,8 +632,12 @@ static snd_pcm_uframes_t msm_pcm_pointer(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct msm_audio *prtd = runtime->private_data;
 
+	/*
+	 * Without period wakeups more than one buffer may have completed
+	 * since the last call, so wrap rather than reset.
+	 */
 	if (prtd->pcm_irq_pos >= prtd->pcm_size)
-		prtd->pcm_irq_pos = 0;
+		prtd->pcm_irq_pos %= prtd->pcm_size;
 
 	pr_debug("pcm_irq_pos = %d\n", prtd->pcm_irq_pos);
 	return bytes_to_frames(runtime, (prtd->pcm_irq_pos));
@@ -18,6 +18,7 @@
 #include <linux/platform_device.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -158,6 +159,48 @@ static void msm_pcm_routing_build_matrix(int fedai_id, int dspst_id,
 			payload.num_copps, payload.copp_ids, 0);
 }
 
+/*
+ * Matrix remaps caused by mixer controls are not sent to the DSP from the
+ * control put. The front-end is marked dirty and the matrix work sends one
+ * ADM matrix command per dirty session once the batch window expires, so
+ * a device switch that flips several mixer controls costs one DSP round
+ * trip per stream rather than one per control, and the caller does not
+ * wait for them.
+ */
+#define MATRIX_BATCH_DELAY_MS	2
+
+static unsigned long matrix_dirty[2];	/* indexed by session type */
+
+static void msm_pcm_routing_matrix_work(struct work_struct *work)
+{
+	unsigned long dirty;
+	int i, session_type, path_type;
+
+	mutex_lock(&routing_lock);
+	for (session_type = SESSION_TYPE_RX; session_type <= SESSION_TYPE_TX;
+	     session_type++) {
+		dirty = xchg(&matrix_dirty[session_type], 0);
+		path_type = (session_type == SESSION_TYPE_RX ?
+			ADM_PATH_PLAYBACK : ADM_PATH_LIVE_REC);
+
+		for_each_set_bit(i, &dirty, MSM_FRONTEND_DAI_MM_SIZE) {
+			if (fe_dai_map[i][session_type] != INVALID_SESSION)
+				msm_pcm_routing_build_matrix(i,
+					fe_dai_map[i][session_type],
+					path_type);
+		}
+	}
+	mutex_unlock(&routing_lock);
+}
+static DECLARE_DELAYED_WORK(matrix_work, msm_pcm_routing_matrix_work);
+
+static void msm_pcm_routing_queue_matrix(int fedai_id, int session_type)
+{
+	set_bit(fedai_id, &matrix_dirty[session_type]);
+	schedule_delayed_work(&matrix_work,
+		msecs_to_jiffies(MATRIX_BATCH_DELAY_MS));
+}
+
 void msm_pcm_routing_reg_phy_stream(int fedai_id, int dspst_id, int stream_type)
 {
 	int i, session_type, path_type, port_type;
@@ -215,6 +258,7 @@ void msm_pcm_routing_reg_phy_stream(int fedai_id, int dspst_id, int stream_type)
 	if (payload.num_copps)
 		adm_matrix_map(dspst_id, path_type,
 			payload.num_copps, payload.copp_ids, 0);
+	clear_bit(fedai_id, &matrix_dirty[session_type]);
 
 	mutex_unlock(&routing_lock);
 }
@@ -316,8 +360,7 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 				msm_bedais[reg].sample_rate, channels,
 				DEFAULT_COPP_TOPOLOGY);
 
-			msm_pcm_routing_build_matrix(val,
-				fe_dai_map[val][session_type], path_type);
+			msm_pcm_routing_queue_matrix(val, session_type);
 		}
 	} else {
 		if (test_bit(val, &msm_bedais[reg].fe_sessions) &&
@@ -327,8 +370,7 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 		if (msm_bedais[reg].active && fe_dai_map[val][session_type] !=
 			INVALID_SESSION) {
 			adm_close(msm_bedais[reg].port_id);
-			msm_pcm_routing_build_matrix(val,
-				fe_dai_map[val][session_type], path_type);
+			msm_pcm_routing_queue_matrix(val, session_type);
 		}
 	}
 	if ((msm_bedais[reg].port_id == VOICE_RECORD_RX)
@@ -443,15 +485,12 @@ static int msm_routing_get_voice_mixer(struct snd_kcontrol *kcontrol,
 	struct soc_mixer_control *mc =
 	(struct soc_mixer_control *)kcontrol->private_value;
 
-	mutex_lock(&routing_lock);
-
+	/* fe_sessions is only updated with atomic bitops */
 	if (test_bit(mc->shift, &msm_bedais[mc->reg].fe_sessions))
 		ucontrol->value.integer.value[0] = 1;
 	else
 		ucontrol->value.integer.value[0] = 0;
 
-	mutex_unlock(&routing_lock);
-
 	pr_debug("%s: reg %x shift %x val %ld\n", __func__, mc->reg, mc->shift,
 			ucontrol->value.integer.value[0]);
 
@@ -1828,6 +1867,7 @@ module_init(msm_soc_routing_platform_init);
 
 static void __exit msm_soc_routing_platform_exit(void)
 {
+	cancel_delayed_work_sync(&matrix_work);
 	platform_driver_unregister(&msm_routing_pcm_driver);
 }
 module_exit(msm_soc_routing_platform_exit);
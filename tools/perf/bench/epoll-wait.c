@@ -0,0 +1,143 @@
+/*
+ * epoll-wait.c
+ *
+ * wait: A writer thread round-robins single bytes over a set of pipes
+ * while the main thread collects them with epoll_wait(). Measures the
+ * per-event cost of the wakeup, ready-list and read path.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+
+#define MAX_EVENTS	64
+
+static int nfds = 64;
+static int loops = 1000000;
+
+static int (*pipes)[2];
+
+static const struct option options[] = {
+	OPT_INTEGER('n', "nfds", &nfds,
+		    "Specify number of pipes watched by epoll"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of events to deliver"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_wait_usage[] = {
+	"perf bench epoll wait <options>",
+	NULL
+};
+
+static void *writer_fn(void *arg __used)
+{
+	char c = 0;
+	int i;
+
+	for (i = 0; i < loops; i++)
+		if (write(pipes[i % nfds][1], &c, 1) != 1)
+			die("write");
+	return NULL;
+}
+
+int bench_epoll_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct epoll_event ev, events[MAX_EVENTS];
+	struct timeval start, stop, diff;
+	unsigned long long result_usec;
+	unsigned long waits = 0;
+	pthread_t writer;
+	int received = 0;
+	int epfd;
+	char c;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_wait_usage, 0);
+
+	if (nfds <= 0 || loops <= 0) {
+		fprintf(stderr, "Invalid nfds or loop count\n");
+		return 1;
+	}
+
+	pipes = zalloc(nfds * sizeof(*pipes));
+	if (!pipes)
+		die("calloc");
+
+	epfd = epoll_create(nfds);
+	if (epfd < 0)
+		die("epoll_create");
+
+	for (i = 0; i < nfds; i++) {
+		if (pipe(pipes[i]))
+			die("pipe");
+		ev.events = EPOLLIN;
+		ev.data.fd = pipes[i][0];
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, pipes[i][0], &ev))
+			die("epoll_ctl");
+	}
+
+	gettimeofday(&start, NULL);
+	if (pthread_create(&writer, NULL, writer_fn, NULL))
+		die("pthread_create");
+
+	while (received < loops) {
+		int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+
+		if (n < 0)
+			die("epoll_wait");
+		waits++;
+		/* level triggered: one byte per report, the rest comes back */
+		for (i = 0; i < n; i++)
+			if (read(events[i].data.fd, &c, 1) == 1)
+				received++;
+	}
+
+	pthread_join(writer, NULL);
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	result_usec = diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Delivered %d events over %d pipes\n\n", loops, nfds);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       diff.tv_sec, (unsigned long) (diff.tv_usec / 1000));
+		printf(" %14lf usecs/event\n",
+		       (double)result_usec / (double)loops);
+		printf(" %14lf events/epoll_wait\n",
+		       (double)loops / (double)waits);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf\n", (double)result_usec / (double)loops);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	for (i = 0; i < nfds; i++) {
+		close(pipes[i][0]);
+		close(pipes[i][1]);
+	}
+	close(epfd);
+	free(pipes);
+	return 0;
+}
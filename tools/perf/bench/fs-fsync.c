@@ -0,0 +1,176 @@
+/*
+ * fs-fsync.c
+ *
+ * fsync: Append small records to a file and fsync() after each one, the
+ * way SQLite appends to its journal or WAL, and report fsync() latency.
+ * Point --dir at a filesystem on a loop device to compare journalling
+ * changes without disturbing the rest of the system.  With --dev naming
+ * that device, the sectors it wrote are read from /sys/block/<dev>/stat
+ * to report how many bytes reached the disk per byte appended.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+
+static const char	*dir	= ".";
+static int		size	= 128;
+static int		loops	= 1000;
+static bool		datasync;
+static const char	*dev;
+
+static const struct option options[] = {
+	OPT_STRING('d', "dir", &dir, ".",
+		    "Specify directory to create the test file in"),
+	OPT_INTEGER('s', "size", &size,
+		    "Specify bytes appended before each fsync"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of append+fsync rounds"),
+	OPT_BOOLEAN('D', "datasync", &datasync,
+		    "Use fdatasync() instead of fsync()"),
+	OPT_STRING('b', "dev", &dev, "loop0",
+		    "Block device under --dir to count written sectors on"),
+	OPT_END()
+};
+
+static const char * const bench_fs_fsync_usage[] = {
+	"perf bench fs fsync <options>",
+	NULL
+};
+
+/* Sectors written by @dev so far, the 7th field of its stat file */
+static u64 dev_sectors_written(void)
+{
+	unsigned long long stat[7];
+	char path[PATH_MAX];
+	FILE *fp;
+	int n;
+
+	snprintf(path, sizeof(path), "/sys/block/%s/stat", dev);
+	fp = fopen(path, "r");
+	if (!fp)
+		die("Can't open %s", path);
+	n = fscanf(fp, "%llu %llu %llu %llu %llu %llu %llu",
+		   &stat[0], &stat[1], &stat[2], &stat[3],
+		   &stat[4], &stat[5], &stat[6]);
+	fclose(fp);
+	if (n != 7)
+		die("Can't parse %s", path);
+	return stat[6];
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int bench_fs_fsync(int argc, const char **argv,
+		   const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	u64 *lat, total = 0;
+	u64 sectors = 0;
+	double amp = 0;
+	char path[PATH_MAX];
+	char *buf;
+	int fd, i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_fs_fsync_usage, 0);
+
+	if (size <= 0 || loops <= 0) {
+		fprintf(stderr, "Invalid size:%d or loop count:%d\n",
+			size, loops);
+		return 1;
+	}
+
+	lat = zalloc(loops * sizeof(*lat));
+	buf = malloc(size);
+	if (!lat || !buf)
+		die("malloc");
+	memset(buf, 'x', size);
+	buf[size - 1] = '\n';
+
+	snprintf(path, sizeof(path), "%s/perf-bench-fsync.%d", dir, getpid());
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+	if (fd < 0) {
+		fprintf(stderr, "Can't create %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	/* Keep the commit of the file creation out of the device count */
+	if (fsync(fd))
+		die("fsync");
+	if (dev)
+		sectors = dev_sectors_written();
+
+	for (i = 0; i < loops; i++) {
+		if (write(fd, buf, size) != size)
+			die("write");
+
+		gettimeofday(&start, NULL);
+		if (datasync ? fdatasync(fd) : fsync(fd))
+			die("fsync");
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff);
+
+		lat[i] = diff.tv_sec * 1000000ULL + diff.tv_usec;
+		total += lat[i];
+	}
+
+	if (dev) {
+		sectors = dev_sectors_written() - sectors;
+		amp = (double)sectors * 512 / ((u64)loops * size);
+	}
+
+	close(fd);
+	unlink(path);
+
+	qsort(lat, loops, sizeof(*lat), cmp_u64);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d %s() calls after %d byte appends in %s\n\n",
+		       loops, datasync ? "fdatasync" : "fsync", size, dir);
+		printf(" %14lf usecs/op (avg)\n", (double)total / loops);
+		printf(" %14" PRIu64 " usecs/op (min)\n", lat[0]);
+		printf(" %14" PRIu64 " usecs/op (median)\n", lat[loops / 2]);
+		printf(" %14" PRIu64 " usecs/op (99th)\n",
+		       lat[(loops - 1) * 99 / 100]);
+		printf(" %14" PRIu64 " usecs/op (max)\n", lat[loops - 1]);
+		if (dev) {
+			printf(" %14lf bytes written to %s/op\n",
+			       (double)sectors * 512 / loops, dev);
+			printf(" %14lf write amplification\n", amp);
+		}
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		if (dev)
+			printf("%lf %lf\n", (double)total / loops, amp);
+		else
+			printf("%lf\n", (double)total / loops);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	free(buf);
+	free(lat);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * futex-hash.c
+ *
+ * hash: Stress the futex hash table with FUTEX_WAKE on futexes that
+ * nobody waits on. Every call hashes the address and takes the hash
+ * bucket lock, which is what dominates uncontended futex cost.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static int nthreads;
+static int nfutexes = 1024;
+static int runtime = 10;
+static bool fshared;
+
+static volatile int done;
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int started;
+
+struct worker {
+	pthread_t	thread;
+	unsigned int	*futex;
+	unsigned long	ops;
+};
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: online cpus)"),
+	OPT_INTEGER('f', "futexes", &nfutexes,
+		    "Specify number of futexes per thread"),
+	OPT_INTEGER('r', "runtime", &runtime,
+		    "Specify runtime (in seconds)"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_hash_usage[] = {
+	"perf bench futex hash <options>",
+	NULL
+};
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	int op = FUTEX_WAKE | (fshared ? 0 : FUTEX_PRIVATE_FLAG);
+	unsigned long ops = 0;
+	int i;
+
+	pthread_mutex_lock(&start_lock);
+	while (!started)
+		pthread_cond_wait(&start_cond, &start_lock);
+	pthread_mutex_unlock(&start_lock);
+
+	while (!done) {
+		for (i = 0; i < nfutexes; i++)
+			syscall(SYS_futex, &w->futex[i], op, 1, NULL, NULL, 0);
+		ops += nfutexes;
+	}
+	w->ops = ops;
+	return NULL;
+}
+
+int bench_futex_hash(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct worker *workers;
+	unsigned long long total = 0;
+	double secs;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_hash_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nfutexes <= 0 || runtime <= 0) {
+		fprintf(stderr, "Invalid futex count or runtime\n");
+		return 1;
+	}
+
+	workers = zalloc(nthreads * sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].futex = zalloc(nfutexes * sizeof(unsigned int));
+		if (!workers[i].futex)
+			die("calloc");
+		if (pthread_create(&workers[i].thread, NULL, worker_fn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	pthread_mutex_lock(&start_lock);
+	started = 1;
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&start_lock);
+
+	sleep(runtime);
+	done = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		total += workers[i].ops;
+		free(workers[i].futex);
+	}
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	secs = diff.tv_sec + diff.tv_usec / 1000000.0;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d threads hashing %d %s futexes each for %d secs\n\n",
+		       nthreads, nfutexes, fshared ? "shared" : "private",
+		       runtime);
+		for (i = 0; i < nthreads; i++)
+			printf(" thread %3d: %14.0lf ops/sec\n", i,
+			       workers[i].ops / secs);
+		printf("\n %14.0lf ops/sec (total)\n", total / secs);
+		printf(" %14lf usecs/op\n",
+		       (double)nthreads * secs * 1000000.0 / total);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.0lf\n", total / secs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	free(workers);
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * ipc-binder.c
+ *
+ * binder: Round trip PING_TRANSACTIONs to the binder context manager
+ * (servicemanager on Android) and report the transaction latency.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include "../../../drivers/staging/android/binder.h"
+
+#define BINDER_VM_SIZE	(128 * 1024)
+
+#ifndef PING_TRANSACTION
+#define PING_TRANSACTION	B_PACK_CHARS('_', 'P', 'N', 'G')
+#endif
+
+static const char	*device	= "/dev/binder";
+static int		loops	= 100000;
+
+static const struct option options[] = {
+	OPT_STRING('d', "device", &device, "/dev/binder",
+		    "Specify binder device node"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of transactions"),
+	OPT_END()
+};
+
+static const char * const bench_ipc_binder_usage[] = {
+	"perf bench ipc binder <options>",
+	NULL
+};
+
+struct ping_cmd {
+	uint32_t				cmd;
+	struct binder_transaction_data		txn;
+} __attribute__((packed));
+
+struct free_cmd {
+	uint32_t	cmd;
+	const void	*buffer;
+} __attribute__((packed));
+
+static int binder_write_read(int fd, void *wbuf, size_t wsize,
+			     void *rbuf, size_t rsize, size_t *consumed)
+{
+	struct binder_write_read bwr;
+
+	memset(&bwr, 0, sizeof(bwr));
+	bwr.write_buffer = (unsigned long)wbuf;
+	bwr.write_size = wsize;
+	bwr.read_buffer = (unsigned long)rbuf;
+	bwr.read_size = rsize;
+
+	if (ioctl(fd, BINDER_WRITE_READ, &bwr) < 0)
+		return -1;
+	*consumed = bwr.read_consumed;
+	return 0;
+}
+
+/*
+ * Send one ping and wait for its reply. Returns 0 on BR_REPLY, -1 on a
+ * failed or dead reply.
+ */
+static int binder_ping(int fd)
+{
+	struct ping_cmd ping;
+	struct free_cmd fc;
+	uint32_t rbuf[64];
+	void *wbuf = &ping;
+	size_t wsize = sizeof(ping);
+	size_t consumed, off;
+
+	memset(&ping, 0, sizeof(ping));
+	ping.cmd = BC_TRANSACTION;
+	ping.txn.target.handle = 0;
+	ping.txn.code = PING_TRANSACTION;
+
+	for (;;) {
+		if (binder_write_read(fd, wbuf, wsize, rbuf, sizeof(rbuf),
+				      &consumed))
+			return -1;
+		wbuf = NULL;
+		wsize = 0;
+
+		for (off = 0; off < consumed; ) {
+			uint32_t cmd = *(uint32_t *)((char *)rbuf + off);
+			struct binder_transaction_data *txn;
+
+			off += sizeof(uint32_t);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_TRANSACTION_COMPLETE:
+				break;
+			case BR_REPLY:
+				txn = (void *)((char *)rbuf + off);
+				fc.cmd = BC_FREE_BUFFER;
+				fc.buffer = txn->data.ptr.buffer;
+				binder_write_read(fd, &fc, sizeof(fc), NULL, 0,
+						  &consumed);
+				return 0;
+			case BR_DEAD_REPLY:
+			case BR_FAILED_REPLY:
+				return -1;
+			default:
+				break;
+			}
+			off += _IOC_SIZE(cmd);
+		}
+	}
+}
+
+int bench_ipc_binder(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	unsigned long long result_usec;
+	void *map;
+	int fd, i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_ipc_binder_usage, 0);
+
+	if (loops <= 0) {
+		fprintf(stderr, "Invalid loop count:%d\n", loops);
+		return 1;
+	}
+
+	fd = open(device, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "Can't open %s: %s\n", device,
+			strerror(errno));
+		return 1;
+	}
+	map = mmap(NULL, BINDER_VM_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		die("binder mmap");
+
+	if (binder_ping(fd)) {
+		fprintf(stderr, "No binder context manager answering pings\n");
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++)
+		if (binder_ping(fd))
+			die("binder transaction failed\n");
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	result_usec = diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Executed %d binder ping transactions\n\n", loops);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       diff.tv_sec, (unsigned long) (diff.tv_usec / 1000));
+		printf(" %14lf usecs/op\n",
+		       (double)result_usec / (double)loops);
+		printf(" %14d ops/sec\n",
+		       (int)((double)loops /
+			     ((double)result_usec / (double)1000000)));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf\n", (double)result_usec / (double)loops);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	munmap(map, BINDER_VM_SIZE);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * ipc-splice.c
+ *
+ * splice: Stream data from a child process through a pipe and drain it
+ * either with splice() into /dev/null, which moves pipe buffers without
+ * copying, or with read(), which goes through copy_to_user().
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+
+#ifndef SPLICE_F_MOVE
+#define SPLICE_F_MOVE	1
+#endif
+
+static const char	*length_str	= "256MB";
+static const char	*chunk_str	= "64KB";
+static bool		use_read;
+
+static const struct option options[] = {
+	OPT_STRING('l', "length", &length_str, "256MB",
+		    "Specify total amount of data to transfer"),
+	OPT_STRING('s', "chunk", &chunk_str, "64KB",
+		    "Specify size of each write/splice"),
+	OPT_BOOLEAN('r', "read", &use_read,
+		    "Drain the pipe with read() instead of splice()"),
+	OPT_END()
+};
+
+static const char * const bench_ipc_splice_usage[] = {
+	"perf bench ipc splice <options>",
+	NULL
+};
+
+static void writer(int fd, size_t len, size_t chunk)
+{
+	char *buf = zalloc(chunk);
+	size_t done = 0;
+	ssize_t ret;
+
+	if (!buf)
+		die("calloc");
+	while (done < len) {
+		ret = write(fd, buf, len - done < chunk ? len - done : chunk);
+		if (ret <= 0)
+			die("write");
+		done += ret;
+	}
+	exit(0);
+}
+
+int bench_ipc_splice(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	size_t len, chunk, done = 0;
+	int pipefd[2], nullfd;
+	int wait_stat;
+	char *buf = NULL;
+	double secs;
+	ssize_t ret;
+	pid_t pid;
+
+	argc = parse_options(argc, argv, options,
+			     bench_ipc_splice_usage, 0);
+
+	len = (size_t)perf_atoll((char *)length_str);
+	chunk = (size_t)perf_atoll((char *)chunk_str);
+	if ((s64)len <= 0 || (s64)chunk <= 0) {
+		fprintf(stderr, "Invalid length:%s or chunk:%s\n",
+			length_str, chunk_str);
+		return 1;
+	}
+
+	nullfd = open("/dev/null", O_WRONLY);
+	if (nullfd < 0)
+		die("/dev/null");
+	if (use_read) {
+		buf = zalloc(chunk);
+		if (!buf)
+			die("calloc");
+	}
+
+	assert(!pipe(pipefd));
+
+	gettimeofday(&start, NULL);
+
+	pid = fork();
+	assert(pid >= 0);
+	if (!pid) {
+		close(pipefd[0]);
+		writer(pipefd[1], len, chunk);
+	}
+	close(pipefd[1]);
+
+	while (done < len) {
+		if (use_read)
+			ret = read(pipefd[0], buf, chunk);
+		else
+			ret = syscall(__NR_splice, pipefd[0], NULL, nullfd,
+				      NULL, chunk, SPLICE_F_MOVE);
+		if (ret <= 0)
+			die(use_read ? "read" : "splice");
+		done += ret;
+	}
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	secs = diff.tv_sec + diff.tv_usec / 1000000.0;
+
+	assert(waitpid(pid, &wait_stat, 0) == pid && WIFEXITED(wait_stat));
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Moved %s through a pipe in %s chunks with %s\n\n",
+		       length_str, chunk_str, use_read ? "read()" : "splice()");
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       diff.tv_sec, (unsigned long) (diff.tv_usec / 1000));
+		printf(" %14lf MB/Sec\n", (double)len / secs / 1024 / 1024);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf\n", (double)len / secs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	close(pipefd[0]);
+	close(nullfd);
+	free(buf);
+	return 0;
+}
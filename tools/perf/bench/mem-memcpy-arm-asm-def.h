@@ -0,0 +1,4 @@
+
+MEMCPY_FN(memcpy_arm_ldm,
+	"arm-ldm",
+	"word aligned memcpy() moving 32 bytes per ldm/stm pair")
@@ -0,0 +1,12 @@
+
+#ifdef ARCH_ARM
+
+#define MEMSET_FN(fn, name, desc)		\
+	extern void *fn(void *, int, size_t);
+
+#include "mem-memset-arm-asm-def.h"
+
+#undef MEMSET_FN
+
+#endif
+
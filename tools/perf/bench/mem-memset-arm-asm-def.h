@@ -0,0 +1,4 @@
+
+MEMSET_FN(memset_arm_stm,
+	"arm-stm",
+	"word aligned memset() storing 32 bytes per stm")
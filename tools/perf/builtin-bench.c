@@ -52,6 +52,52 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "memset",
+	  "Simple memory set in various ways",
+	  bench_mem_memset },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite futex_suites[] = {
+	{ "hash",
+	  "Uncontended FUTEX_WAKE calls hammering the futex hash",
+	  bench_futex_hash },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite epoll_suites[] = {
+	{ "wait",
+	  "Events delivered through epoll_wait() from a writer thread",
+	  bench_epoll_wait },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite ipc_suites[] = {
+	{ "splice",
+	  "Pipe throughput drained with splice() or read()",
+	  bench_ipc_splice },
+	{ "binder",
+	  "Binder ping transactions to the context manager",
+	  bench_ipc_binder },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite fs_suites[] = {
+	{ "fsync",
+	  "fsync() latency after small appends",
+	  bench_fs_fsync },
 	suite_all,
 	{ NULL,
 	  NULL,
@@ -71,6 +117,18 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "futex",
+	  "futex hash and wakeup performance",
+	  futex_suites },
+	{ "epoll",
+	  "epoll event delivery",
+	  epoll_suites },
+	{ "ipc",
+	  "pipe and binder data transfer",
+	  ipc_suites },
+	{ "fs",
+	  "filesystem sync latency",
+	  fs_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },
@@ -10,6 +10,7 @@
 #include "util/evlist.h"
 #include "util/parse-options.h"
 #include "util/parse-events.h"
+#include "util/krait-events.h"
 #include "util/symbol.h"
 #include "util/thread_map.h"
 
@@ -600,6 +601,73 @@ out_free_threads:
 #undef nsyscalls
 }
 
+static int test__krait_events(void)
+{
+	static const struct {
+		const char	*str;
+		u32		type;
+		u64		config;
+	} good[] = {
+		{ "krait-l1:0x10011",	PERF_TYPE_RAW,		0x10011 },
+		{ "krait-l1:20153",	PERF_TYPE_RAW,		0x20153 },
+		{ "krait-l2:0x3103",	PERF_TYPE_SHARED,	0x3103 },
+		{ "krait-l2:fe",	PERF_TYPE_SHARED,	0xfe },
+	};
+	static const char * const bad[] = {
+		"krait-l1:0x14011",	/* PMRESR register out of range */
+		"krait-l1:0x10014",	/* group out of range */
+		"krait-l1:0x30011",	/* unknown prefix */
+		"krait-l1:0x20e01",	/* VeNum code out of range */
+		"krait-l2:0x10004",	/* more than 16 bits */
+		"krait-l1-icache-accessx",
+		"krait-l3-cycles",
+	};
+	const struct krait_event *ev;
+	struct perf_event_attr attr;
+	unsigned int i;
+	int n;
+
+	for (ev = krait_events; ev->name; ev++) {
+		memset(&attr, 0, sizeof(attr));
+		n = krait_event__parse(ev->name, &attr);
+		if (n != (int)strlen(ev->name) || attr.type != ev->type ||
+		    attr.config != ev->config) {
+			pr_debug("%s parsed wrongly\n", ev->name);
+			return -1;
+		}
+		if (ev->type == PERF_TYPE_RAW ?
+		    !krait_l1_config__valid(ev->config) :
+		    !krait_l2_config__valid(ev->config)) {
+			pr_debug("%s has an invalid encoding\n", ev->name);
+			return -1;
+		}
+		if (strcmp(krait_event__name(ev->type, ev->config), ev->name)) {
+			pr_debug("%s doesn't map back to its name\n", ev->name);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(good); i++) {
+		memset(&attr, 0, sizeof(attr));
+		n = krait_event__parse(good[i].str, &attr);
+		if (n != (int)strlen(good[i].str) ||
+		    attr.type != good[i].type ||
+		    attr.config != good[i].config) {
+			pr_debug("%s parsed wrongly\n", good[i].str);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bad); i++) {
+		if (krait_event__parse(bad[i], &attr)) {
+			pr_debug("%s should have been rejected\n", bad[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 static struct test {
 	const char *desc;
 	int (*func)(void);
@@ -620,6 +688,10 @@ static struct test {
 		.desc = "read samples using the mmap interface",
 		.func = test__basic_mmap,
 	},
+	{
+		.desc = "parse Krait PMU event names and encodings",
+		.func = test__krait_events,
+	},
 	{
 		.func = NULL,
 	},
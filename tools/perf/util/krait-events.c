@@ -0,0 +1,128 @@
+#include "util.h"
+#include "symbol.h"
+#include "krait-events.h"
+#include "../../../include/linux/perf_event.h"
+
+#define KRAIT_L1_PREFIX		1
+#define KRAIT_VENUM_PREFIX	2
+#define KRAIT_L1_MAX_REG	3
+#define KRAIT_L2_CYCLES		0xfe
+
+const struct krait_event krait_events[] = {
+	{ "krait-l1-icache-access", PERF_TYPE_RAW, 0x10011,
+	  "L1 instruction cache accesses" },
+	{ "krait-l1-icache-miss", PERF_TYPE_RAW, 0x10010,
+	  "L1 instruction cache misses" },
+	{ "krait-l1-itlb-access", PERF_TYPE_RAW, 0x12222,
+	  "L1 ITLB accesses (Krait v2 and later)" },
+	{ "krait-l1-dtlb-access", PERF_TYPE_RAW, 0x12210,
+	  "L1 DTLB accesses (Krait v2 and later)" },
+	{ "krait-p1-l1-itlb-access", PERF_TYPE_RAW, 0x121b2,
+	  "L1 ITLB accesses (Krait v1)" },
+	{ "krait-p1-l1-dtlb-access", PERF_TYPE_RAW, 0x121c0,
+	  "L1 DTLB accesses (Krait v1)" },
+	{ "krait-l2-cycles", PERF_TYPE_SHARED, KRAIT_L2_CYCLES,
+	  "L2 cycle counter, one user system wide" },
+	{ NULL, 0, 0, NULL },
+};
+
+/* Mirrors the checks in get_krait_evtinfo() in the kernel */
+bool krait_l1_config__valid(u64 config)
+{
+	unsigned int prefix = (config >> 16) & 0xf;
+	unsigned int reg = (config >> 12) & 0xf;
+	unsigned int code = (config >> 4) & 0xff;
+	unsigned int group = config & 0xf;
+
+	if (config & ~0xfffffULL)
+		return false;
+	if (group > 3 || reg > KRAIT_L1_MAX_REG)
+		return false;
+	if (prefix == KRAIT_L1_PREFIX)
+		return true;
+	if (prefix == KRAIT_VENUM_PREFIX)
+		return !(code & 0xe0);
+	return false;
+}
+
+bool krait_l2_config__valid(u64 config)
+{
+	if (config == KRAIT_L2_CYCLES)
+		return true;
+	return !(config & ~0xffffULL) && (config & 0xf) <= 3;
+}
+
+/*
+ * Parse a Krait event at the start of @str: a name from krait_events[],
+ * "krait-l1:<hex>" or "krait-l2:<hex>". Returns the number of characters
+ * consumed, or 0 if @str isn't a (valid) Krait event.
+ */
+int krait_event__parse(const char *str, struct perf_event_attr *attr)
+{
+	const struct krait_event *ev;
+	u64 config;
+	int n;
+
+	if (strncmp(str, "krait-", 6))
+		return 0;
+
+	if (!strncmp(str, "krait-l1:", 9) || !strncmp(str, "krait-l2:", 9)) {
+		bool l2 = str[7] == '2';
+		const char *p = str + 9;
+
+		if (!strncmp(p, "0x", 2))
+			p += 2;
+		n = hex2u64(p, &config);
+		if (n <= 0)
+			return 0;
+		if (l2 ? !krait_l2_config__valid(config) :
+			 !krait_l1_config__valid(config))
+			return 0;
+		attr->type = l2 ? PERF_TYPE_SHARED : PERF_TYPE_RAW;
+		attr->config = config;
+		return p + n - str;
+	}
+
+	for (ev = krait_events; ev->name; ev++) {
+		n = strlen(ev->name);
+		if (strncmp(str, ev->name, n))
+			continue;
+		/* don't let krait-l1-icache-access match krait-l1-icache-accessX */
+		if (str[n] && str[n] != ':' && str[n] != ',' && !isspace(str[n]))
+			continue;
+		attr->type = ev->type;
+		attr->config = ev->config;
+		return n;
+	}
+	return 0;
+}
+
+const char *krait_event__name(u32 type, u64 config)
+{
+	const struct krait_event *ev;
+
+	for (ev = krait_events; ev->name; ev++)
+		if (ev->type == type && ev->config == config)
+			return ev->name;
+	return NULL;
+}
+
+int print_krait_events(const char *event_glob)
+{
+	const struct krait_event *ev;
+	int printed = 0;
+
+	for (ev = krait_events; ev->name; ev++) {
+		if (event_glob != NULL && !strglobmatch(ev->name, event_glob))
+			continue;
+		printf("  %-50s [%s]\n", ev->name,
+		       ev->type == PERF_TYPE_SHARED ? "Krait L2 event" :
+						      "Krait L1 event");
+		printed++;
+	}
+	if (event_glob == NULL) {
+		printf("  %-50s [%s]\n", "krait-l1:0xPRCCG", "Krait L1 event");
+		printf("  %-50s [%s]\n", "krait-l2:0xRCCG", "Krait L2 event");
+	}
+	return printed;
+}
@@ -0,0 +1,33 @@
+#ifndef __PERF_KRAIT_EVENTS_H
+#define __PERF_KRAIT_EVENTS_H
+
+#include <stdbool.h>
+#include "types.h"
+
+struct perf_event_attr;
+
+/*
+ * Named events for the Qualcomm Krait CPU PMU (L1, counted through the
+ * per-cpu ARMv7 PMU as raw events) and the Krait L2 PMU, which is shared
+ * by all cores and registered as PERF_TYPE_SHARED.
+ *
+ * L1 raw encoding is 0xPRCCG: P = prefix (1 Krait, 2 VeNum), R = PMRESR
+ * register, CC = code, G = group. L2 encoding is 0xRCCG with the same
+ * meaning, or 0xfe for the L2 cycle counter.
+ */
+struct krait_event {
+	const char	*name;
+	u32		type;
+	u64		config;
+	const char	*desc;
+};
+
+extern const struct krait_event krait_events[];
+
+bool krait_l1_config__valid(u64 config);
+bool krait_l2_config__valid(u64 config);
+int krait_event__parse(const char *str, struct perf_event_attr *attr);
+const char *krait_event__name(u32 type, u64 config);
+int print_krait_events(const char *event_glob);
+
+#endif /* __PERF_KRAIT_EVENTS_H */
@@ -11,6 +11,7 @@
 #include "cache.h"
 #include "header.h"
 #include "debugfs.h"
+#include "krait-events.h"
 
 struct event_symbol {
 	u8		type;
@@ -304,6 +305,15 @@ const char *__event_name(int type, u64 config)
 {
 	static char buf[32];
 
+#ifdef ARCH_ARM
+	if (type == PERF_TYPE_RAW || type == PERF_TYPE_SHARED) {
+		const char *name = krait_event__name(type, config);
+
+		if (name)
+			return name;
+	}
+#endif
+
 	if (type == PERF_TYPE_RAW) {
 		sprintf(buf, "raw 0x%" PRIx64, config);
 		return buf;
@@ -702,6 +712,17 @@ parse_raw_event(const char **strp, struct perf_event_attr *attr)
 	return EVT_FAILED;
 }
 
+static enum event_result
+parse_krait_event(const char **strp, struct perf_event_attr *attr)
+{
+	int n = krait_event__parse(*strp, attr);
+
+	if (!n)
+		return EVT_FAILED;
+	*strp += n;
+	return EVT_HANDLED;
+}
+
 static enum event_result
 parse_numeric_event(const char **strp, struct perf_event_attr *attr)
 {
@@ -783,6 +804,10 @@ parse_event_symbols(const struct option *opt, const char **str,
 {
 	enum event_result ret;
 
+	ret = parse_krait_event(str, attr);
+	if (ret != EVT_FAILED)
+		goto modifier;
+
 	ret = parse_tracepoint_event(opt, str, attr);
 	if (ret != EVT_FAILED)
 		goto modifier;
@@ -1072,6 +1097,10 @@ void print_events(const char *event_glob)
 		printf("\n");
 	}
 	print_hwcache_events(event_glob);
+#ifdef ARCH_ARM
+	printf("\n");
+	print_krait_events(event_glob);
+#endif
 
 	if (event_glob != NULL)
 		return;
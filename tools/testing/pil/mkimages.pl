@@ -0,0 +1,73 @@
+#!/usr/bin/perl -w
+#
+# Generate the dummy peripheral images used by arch/arm/mach-msm/pil-test.c
+# Licensed under the terms of the GNU GPL License version 2
+#
+# usage: mkimages.pl <paddr> <firmware dir>
+#
+# pil_test.mdt describes four segments placed relative to <paddr>:
+#
+#   0  0x0000  0x2000 bytes from pil_test.b00
+#   1  0x2000  hash segment, must not be loaded
+#   2  0x4000  0x1800 bytes from pil_test.b02, zero filled to 0x3000
+#   3  0x8000  0x1000 bytes of zeroes, no blob
+#
+# Byte n of a blob for segment s is (s * 0x3b + n) & 0xff.  pil_test_bad.mdt
+# has the same layout behind a broken ELF magic.
+
+use strict;
+
+my $PT_LOAD = 1;
+my $HASH_FLAGS = 0x2 << 24;
+
+die "usage: $0 <paddr> <firmware dir>\n" if (@ARGV != 2);
+my $paddr = oct($ARGV[0]);
+my $dir = $ARGV[1];
+
+# [ offset, filesz, memsz, flags ]
+my @segs = (
+	[ 0x0000, 0x2000, 0x2000, 0 ],
+	[ 0x2000, 0x0100, 0x0100, $HASH_FLAGS ],
+	[ 0x4000, 0x1800, 0x3000, 0 ],
+	[ 0x8000, 0x0000, 0x1000, 0 ],
+);
+
+sub write_file {
+	my ($name, $data) = @_;
+
+	open(my $fh, ">", "$dir/$name") or die "$dir/$name: $!\n";
+	binmode($fh);
+	print $fh $data;
+	close($fh);
+}
+
+sub mdt {
+	my ($magic) = @_;
+	my $phnum = scalar(@segs);
+	my $data;
+
+	# struct elf32_hdr: ET_EXEC, EM_ARM
+	$data = pack("a4 C C C x9 v v V V V V V v v v v v v",
+		     $magic, 1, 1, 1, 2, 40, 1, $paddr, 52, 0, 0,
+		     52, 32, $phnum, 0, 0, 0);
+
+	# struct elf32_phdr, blobs are separate files so p_offset is unused
+	foreach my $s (@segs) {
+		my ($off, $filesz, $memsz, $flags) = @$s;
+
+		$data .= pack("V8", $PT_LOAD, 0, $paddr + $off,
+			      $paddr + $off, $filesz, $memsz, $flags, 4);
+	}
+	return $data;
+}
+
+write_file("pil_test.mdt", mdt("\x7fELF"));
+write_file("pil_test_bad.mdt", mdt("\x7fBAD"));
+
+for (my $i = 0; $i < @segs; $i++) {
+	my ($off, $filesz, $memsz, $flags) = @{$segs[$i]};
+
+	next if (!$filesz || $flags == $HASH_FLAGS);
+	write_file(sprintf("pil_test.b%02d", $i),
+		   pack("C*", map { ($i * 0x3b + $_) & 0xff } 0 .. $filesz - 1));
+}
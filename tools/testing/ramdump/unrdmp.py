@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 and
+# only version 2 as published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+"""Decode a compressed MSM ramdump stream.
+
+Usage: unrdmp.py <compressed dump> <output>
+
+The chunk format is described in Documentation/arm/msm/ramdump.txt.  The
+output is the plain or ELF dump the device would have sent uncompressed.
+LZO chunks need the python-lzo module.
+"""
+
+import struct
+import sys
+
+CHUNK_MAGIC = 0x504d4452
+CHUNK_SIZE = 128 * 1024
+CHUNK_ZERO = 0x1
+CHUNK_RAW = 0x2
+CHUNK_LZO = 0x4
+HDR = struct.Struct('<IIQII')
+
+
+def lzo_decompress(data, raw_len):
+    try:
+        import lzo
+    except ImportError:
+        sys.exit('LZO chunk found but python-lzo is not installed')
+    return lzo.decompress(data, False, raw_len)
+
+
+def decode(src, dst):
+    pos = 0
+    while True:
+        hdr = src.read(HDR.size)
+        if not hdr:
+            return pos
+        if len(hdr) != HDR.size:
+            sys.exit('truncated chunk header at %#x' % pos)
+
+        magic, flags, offset, raw_len, data_len = HDR.unpack(hdr)
+        if magic != CHUNK_MAGIC:
+            sys.exit('bad magic %#x at %#x' % (magic, pos))
+        if offset != pos:
+            sys.exit('chunk at %#x claims offset %#x' % (pos, offset))
+        if not 0 < raw_len <= CHUNK_SIZE or data_len > raw_len:
+            sys.exit('bad sizes %#x/%#x at %#x' % (raw_len, data_len, pos))
+
+        data = src.read(data_len)
+        if len(data) != data_len:
+            sys.exit('truncated payload at %#x' % pos)
+
+        if flags == CHUNK_ZERO:
+            data = b'\0' * raw_len
+        elif flags == CHUNK_LZO:
+            data = lzo_decompress(data, raw_len)
+        elif flags != CHUNK_RAW:
+            sys.exit('bad flags %#x at %#x' % (flags, pos))
+        if len(data) != raw_len:
+            sys.exit('chunk at %#x decodes to %#x bytes, expected %#x' %
+                     (pos, len(data), raw_len))
+
+        dst.write(data)
+        pos += raw_len
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], 'rb') as src:
+        with open(sys.argv[2], 'wb') as dst:
+            size = decode(src, dst)
+    print('%s: %d bytes' % (sys.argv[2], size))
+
+
+if __name__ == '__main__':
+    main()